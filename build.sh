@@ -10,7 +10,7 @@ fi
 
 echo ">>> Building $contract contract..."
 
-# eosio.cdt v1.6.1
+# cdt v3.0 or later, required for the read-only getstats action
 # -contract=<string>       - Contract name
 # -o=<string>              - Write output to <file>
 # -abigen                  - Generate ABI
@@ -18,4 +18,6 @@ echo ">>> Building $contract contract..."
 # -L=<string>              - Add directory to library search path
 # -R=<string>              - Add a resource path for inclusion
 
-eosio-cpp -I="./$contract/include/" -R="./$contract/ricardian" -o="./$contract/build/$contract.wasm" -contract="$contract" -abigen ./$contract/src/$contract.cpp
+# OIG_LOG_LEVEL=<0-2> ./build.sh oig compiles console output in, see oig.hpp
+# OIG_TESTNET=1 ./build.sh oig builds the testnet variant including the debug actions
+cdt-cpp -DOIG_LOG_LEVEL=${OIG_LOG_LEVEL:-0} -DOIG_TESTNET=${OIG_TESTNET:-0} -I="./$contract/include/" -R="./$contract/ricardian" -o="./$contract/build/$contract.wasm" -contract="$contract" -abigen ./$contract/src/$contract.cpp
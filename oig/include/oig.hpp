@@ -2,10 +2,33 @@
 #include <eosio/singleton.hpp>
 #include <eosio/action.hpp>
 #include <eosio/asset.hpp>
+#include <algorithm>
+#include <cstring>
+#include <map>
 
 using namespace std;
 using namespace eosio;
 
+// Console output level, set by the OIG_LOG_LEVEL CMake option.
+// 0 compiles all diagnostic output away, 1 keeps warnings, 2 keeps debug messages.
+#ifndef OIG_LOG_LEVEL
+#define OIG_LOG_LEVEL 0
+#endif
+
+// Build variant settings, set by the CMake options of the same name.
+// OIG_TESTNET 1 compiles in the debug and maintenance actions, 0 builds the production contract.
+#ifndef OIG_TESTNET
+#define OIG_TESTNET 0
+#endif
+// account hosting the decide contract
+#ifndef OIG_DECIDE_ACCOUNT
+#define OIG_DECIDE_ACCOUNT "decide"
+#endif
+// decide ballot creation fee in WAX units (8 decimals), 30 WAX
+#ifndef OIG_BALLOT_FEE
+#define OIG_BALLOT_FEE 3000000000
+#endif
+
 namespace oigspace {
 
     CONTRACT oig : public contract {
@@ -13,49 +36,145 @@ namespace oigspace {
             using contract::contract;
             static constexpr symbol WAX_SYM = symbol("WAX", 8);     // The system token and it's decimal places
             static constexpr symbol VOTE_SYM = symbol("VOTE", 8);   // The treasury symbol referring to WAX_SYM
+            static constexpr name DECIDE = name(OIG_DECIDE_ACCOUNT);  // decide contract account
+            static constexpr int64_t BALLOT_FEE = OIG_BALLOT_FEE;   // decide ballot creation fee in WAX units
+            static constexpr uint16_t NMN_BATCH = 50;               // Default nominations scanned per call when closing nominations
+            static constexpr uint16_t SYNC_BATCH = 100;             // Default voters synchronized per call when closing the ballot
+            static constexpr uint16_t CLEANUP_BATCH = 100;          // Default rows erased per call during cleanup
+            static constexpr uint16_t REG_BATCH = 50;               // Default queued voters registered per call
+            static constexpr uint8_t PROFILE_FLAG = 0x01;           // nominee flag: profile stored in the profiles table
+            static constexpr uint8_t FIELD_NAME = 0;                // nomfield() fields, the name is stored with the nominee
+            static constexpr uint8_t FIELD_DESCRIPTOR = 1;          // all other fields are stored in the profile
+            static constexpr uint8_t FIELD_PICTURE = 2;
+            static constexpr uint8_t FIELD_TELEGRAM = 3;
+            static constexpr uint8_t FIELD_TWITTER = 4;
+            static constexpr uint8_t FIELD_WECHAT = 5;
+            static constexpr uint8_t VOTER_SHARDS = 8;              // voter pool shards, each one is a table scope
+            static constexpr uint32_t ROW_OVERHEAD = 112;           // RAM billed per table row on top of its data
+            static constexpr uint8_t LOG_LEVEL = OIG_LOG_LEVEL;     // compiled in console output, see logmsg()
+            static constexpr uint8_t LOG_WARN = 1;                  // unexpected but handled conditions
+            static constexpr uint8_t LOG_DEBUG = 2;                 // per action diagnostics
+
+            // prints "oig: " followed by the arguments if 'level' is compiled in, compiled away otherwise
+            template<uint8_t level, typename... Args>
+            static void logmsg(Args&&... args) {
+                if constexpr (level <= LOG_LEVEL) {
+                    print("oig: ", std::forward<Args>(args)..., "\n");
+                }
+            }
+
+            // voter pool shard of a voter, spreads sequential account names evenly
+            static uint64_t voter_shard(name voter) { return ((voter.value * 0x9E3779B97F4A7C15ULL) >> 32) % VOTER_SHARDS; }
+
+            // return value of getstats()
+            struct electionstats {
+                name ballot;
+                uint8_t state;
+                uint32_t voters;                // voters in the voter pool, including queued registrations
+                uint32_t synced_voters;         // voters scanned by the sync of this ballot
+                uint32_t pending_voters;        // voters left to be scanned by the sync of this ballot
+                uint32_t total_nominations;
+                uint32_t accepted_nominations;
+                uint32_t nmn_added;             // candidates added to the ballot while closing nominations
+                time_point_sec next_deadline;   // next time based state transition, if any
+                uint32_t contract_ram;          // estimated RAM paid by the contract for this election, in bytes
+                EOSLIB_SERIALIZE(electionstats, (ballot)(state)(voters)(synced_voters)(pending_voters)(total_nominations)(accepted_nominations)(nmn_added)(next_deadline)(contract_ram))
+            };
 
             /*
              *   Registers the contract as voter on decide to allow it to create ballots.
-             *   Sets the contract state to clean.
+             *   Marks the contract as initialized.
              *   Requires decide to be intitialized and treasury to be set up.
              *   auth: oig
              * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
             ACTION init();
 
             /*
-             *   Initializes or cancels the election process
+             *   Moves up to 'count' voters of a pre multi-election deployment into the voter pool.
+             *   Needs to be repeated until all legacy voters are moved, before init() is called.
+             *   auth: oig
+             * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+            ACTION migrate(uint16_t count);
+
+            /*
+             *   Creates a new election with the next ballot key.
+             *   Multiple elections can run at the same time.
+             *   auth: oig
+             * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+            ACTION inaugurate( string title, string description, string content, time_point_sec nmn_open, time_point_sec nmn_close, time_point_sec vote_open, time_point_sec vote_close);
+
+            /*
+             *   Cancels the election 'ballot' before its ballot is created.
              *   auth: oig
              * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
-            ACTION inaugurate( string title, string description, string content, time_point_sec nmn_open, time_point_sec nmn_close, time_point_sec vote_open, time_point_sec vote_close, bool cancel);
+            ACTION cancel(name ballot);
             
             /*
              *   Allows one account to nominate itself or someone else.
              *   Self nominations are automatically accepted.
              *   auth: nominator
              * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
-            ACTION nominate(name nominator, name nominee);
+            ACTION nominate(name ballot, name nominator, name nominee);
 
             /*
              *   Called to accept or decline a nomination.
              *   Declining a nomintation will delete it.
              *   auth: nominee
              * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
-            ACTION proclaim(name nominee, bool decision);
+            ACTION proclaim(name ballot, name nominee, bool decision);
 
             /*
              *   Allows nominees to provide personal info or delete given info.
              *   auth: nominee
              * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
-            ACTION nominf(name nominee, string name, string descriptor, string picture, string telegram, string twitter, string wechat, bool remove);
+            ACTION nominf(name ballot, name nominee, string name, string descriptor, string picture, string telegram, string twitter, string wechat, bool remove);
 
             /*
-             *   Calls refresh_state() to progress in election if needed
+             *   Allows nominees to update a single field of their info, see FIELD_NAME to FIELD_WECHAT.
+             *   auth: nominee
+             * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+            ACTION nomfield(name ballot, name nominee, uint8_t field, string value);
+
+            /*
+             *   Drains queued registrations and calls refresh_state() to progress in election if needed
              * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
-            ACTION updtstate();
+            ACTION updtstate(name ballot);
+
+            /*
+             *   Registers a batch of queued voters with decide, independent of any election.
+             *   auth: none
+             * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+            ACTION drain();
+
+            /*
+             *   Runs up to 'rounds' state_refresh() batches and rewards the keeper per processed row.
+             *   An empty ballot only drains the registration queue.
+             *   auth: keeper
+             * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+            ACTION crank(name keeper, name ballot, uint8_t rounds);
+
+            /*
+             *   Logs a state transition or processed batch to the action traces. Inline only.
+             *   auth: oig
+             * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+            ACTION logstate(name ballot, uint8_t old_state, uint8_t new_state, uint32_t rows, time_point_sec time);
+
+            /*
+             *   Returns the progress counters of an election. Read-only, requires CDT 3.0 or later.
+             *   auth: none
+             * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+            [[eosio::action, eosio::read_only]] electionstats getstats(name ballot);
+
+            /*
+             *   Synchronizes a batch of voters of one voter pool shard after voting ended.
+             *   Shards don't share rows, multiple shards can be synced within the same block.
+             *   auth: none
+             * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+            ACTION syncshard(name ballot, uint64_t shard);
 
             /*
              *   Verifies an account is registered as voter with decide in the (8,Vote) treasury.
-             *   Registers and adds it to the tracking pool if need.
+             *   Queues it for registration and tracking if needed.
              *   auth: voter
              * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
             ACTION regvoter(name voter);
@@ -64,80 +183,179 @@ namespace oigspace {
              *   Sets an ended election into cleanup state and starts the cleanup process.
              *   auth: oig
              * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
-            ACTION endelection();
+            ACTION endelection(name ballot);
+
+            /*
+             *   Catches decide's result broadcast of a closed ballot, archives the results and sets the cleanup state.
+             *   auth: decide, first receiver needs to be DECIDE
+             * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+            [[eosio::on_notify("*::broadcast")]] void onbroadcast(name ballot_name, map<name, asset> final_results, uint32_t total_voters);
 
 
             /*
-             *   Cleanup function.
+             *   Cleanup function. Runs one cleanup batch.
              *   auth: oig
              *   TODO: move to private after data election.
              * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
-            ACTION cleanup();
+            ACTION cleanup(name ballot);
+
+            /*
+             *   Sets the batch sizes used by state_refresh() and cleanup.
+             *   auth: oig
+             * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+            ACTION setconfig(uint16_t nmn_batch, uint16_t sync_batch, uint16_t cleanup_batch, uint16_t reg_batch, asset crank_reward, uint16_t presync_batch);
 
 
+#if OIG_TESTNET
             /*
-             *   Debug and maintenance functions. To be removed for go live.
+             *   Debug and maintenance functions. Only compiled into testnet builds (OIG_TESTNET).
+             *   fakenom(), fakevoters() and simulate() generate load for testing stages at scale.
              *   Consult source documentation before execution.
              *   auth: oig
-             * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * 
-            ACTION addnomn(name nominee);
-            ACTION simulate();
+             * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+            ACTION addnomn(name ballot, name nominee);
+            ACTION simulate(name ballot);
             ACTION setvoters(vector<name> voters);
-            ACTION fakenom();
-            ACTION reset();
-            ACTION addvoter(name voter);*/
+            ACTION fakevoters(uint32_t count);
+            ACTION fakenom(name ballot, uint16_t count, bool accepted);
+            ACTION reset(name ballot);
+            ACTION addvoter(name voter);
             ACTION setballot(name id);
-            
+#endif
 
-        private:
 
-            /*
-             *   Synchronizes a users vote stake with his WAX stake during an election.
-             * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
-            void syncvoter(name voter, name ballot);
+        private:
 
-            /*
-             *   Election contract core logic. Progresses the election through it's stages.
-             *   Consult source documentation for further clarification.
-             * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
-            uint8_t state_refresh();
+            //==================================== tables ====================================
 
+            // contract state table
+            // scope: self
+            TABLE globalstate {
+                bool initialized = false;       // set by init()
+                name last_ballot = name("oig"); // key of the last created election, incremented for every election
+                EOSLIB_SERIALIZE(globalstate, (initialized)(last_ballot))
+            };
+            typedef singleton<name("globalstate"), globalstate> globalstate_singleton;
 
+            // legacy election singleton
+            // State of deployments before multiple elections. The voter lists are moved into the 
+            // voter pool by migrate(), init() removes the singleton afterwards. Not part of the ABI.
+            // scope: self
+            struct legacyelection {
+                name ballot;    // last ballot created by the old deployment
+                uint8_t state;  // 0 once the old election is cleaned up, 10 if never initialized
+                string title;
+                string description;
+                string content;
+                uint8_t nom_count;
+                vector<name> voter;         // registered voters, not yet synced for the last ballot
+                vector<name> synced_voter;  // registered voters, synced for the last ballot
+                time_point_sec nmn_open;
+                time_point_sec nmn_close;
+                time_point_sec vote_open;
+                time_point_sec vote_close;
+                EOSLIB_SERIALIZE(legacyelection, (ballot)(state)(title)(description)(content)(nom_count)(voter)(synced_voter)(nmn_open)(nmn_close)(vote_open)(vote_close))
+            };
+            typedef singleton<name("election"), legacyelection> legacyelection_singleton;
 
-            //==================================== tables ====================================
+            // legacy voter table
+            // Registration flags of deployments before the voter pool, paid by the contract, erased by migrate().
+            // Not part of the ABI.
+            // scope: voter
+            struct legacyvoter {
+                name referrer;
+                symbol treasury;
+                name voter;
+                uint64_t primary_key() const { return referrer.value; }
+                EOSLIB_SERIALIZE(legacyvoter, (referrer)(treasury)(voter))
+            };
+            typedef multi_index<name("reggedvoters"), legacyvoter> legacyvoters_table;
 
             // elections table
+            // Running elections, erased once cleaned up
             // scope: self
             TABLE election { 
-                name ballot = name("oig"); // stores the primary key for an election to be used in ballot creation
-                uint8_t state = 0;  // tracks the contract state
+                name ballot;        // primary key of the election, used as decide ballot name and as table scope
+                uint8_t state = 1;  // tracks the election state
                 string title;       // Election title
                 string description; // Election description
                 string content;     // IPFS link or URL for further details
-                uint8_t nom_count = 0;  // Tracking the nomination count
-                vector<name> voter; // Containing all voters registered with (8,VOTE) that need to be synchronized
-                vector<name> synced_voter; // Stores synchronized voters during ballot evalutation
+                uint32_t total_nominations = 0;    // Tracking the nomination count
+                uint32_t accepted_nominations = 0; // Tracking the accepted nomination count
+                uint32_t nmn_added = 0; // candidates added to the ballot while closing nominations
+                name nmn_cursor;        // last candidate added to the ballot while closing nominations
+                uint8_t presync_shard = 0;  // voter pool shard the rolling pre-sync is working on
                 time_point_sec nmn_open;   //time that nominations begin
                 time_point_sec nmn_close;  //time that nominations close
                 time_point_sec vote_open;  //time that voting can be opened
                 time_point_sec vote_close; //time that voting closes
-                EOSLIB_SERIALIZE(election, (ballot)(state)(title)(description)(content)(nom_count)(voter)(synced_voter)(nmn_open)(nmn_close)(vote_open)(vote_close))
+                uint64_t primary_key() const { return ballot.value; }
+                EOSLIB_SERIALIZE(election, (ballot)(state)(title)(description)(content)(total_nominations)(accepted_nominations)(nmn_added)(nmn_cursor)(presync_shard)(nmn_open)(nmn_close)(vote_open)(vote_close))
             };
-            typedef singleton<name("election"), election> election_singleton;
+            typedef multi_index<name("elections"), election> elections_table;
 
-            // voter table
-            // scope: voter
-            TABLE reggedvoter{
-                name referrer; // tracks the owner of said treasury 
-                symbol treasury; // treasury identifier
+            // config table
+            // scope: self
+            TABLE config {
+                uint16_t nmn_batch = NMN_BATCH;         // nominations scanned per call when closing nominations
+                uint16_t sync_batch = SYNC_BATCH;       // voters synchronized per call when closing the ballot
+                uint16_t cleanup_batch = CLEANUP_BATCH; // rows erased per call during cleanup
+                uint16_t reg_batch = REG_BATCH;         // queued voters registered per call
+                asset crank_reward = asset(0, WAX_SYM); // reward per row processed by crank()
+                uint16_t presync_batch = 0;             // voters pre-synced per call while voting is open, 0 disables
+                EOSLIB_SERIALIZE(config, (nmn_batch)(sync_batch)(cleanup_batch)(reg_batch)(crank_reward)(presync_batch))
+            };
+            typedef singleton<name("config"), config> config_singleton;
+
+            // voter table, the voter pool
+            // Rows are paid by the voters.
+            // Contains all voters registered with (8,VOTE) that need to be synchronized
+            // A byreferrer index can be added once 3rd party treasuries are supported.
+            // scope: voter_shard(voter)
+            TABLE reggedvoter {
                 name voter;
-                auto primary_key() const { return referrer.value; } // possible conflict if we extend the scope of this contract
-                EOSLIB_SERIALIZE(reggedvoter, (referrer)(treasury)(voter))
+                name referrer;      // tracks the owner of said treasury 
+                symbol treasury;    // treasury identifier
+                uint64_t primary_key() const { return voter.value; }
+                EOSLIB_SERIALIZE(reggedvoter, (voter)(referrer)(treasury))
             };
-            typedef multi_index<name("reggedvoters"), reggedvoter> reggedvoters_table;
+            typedef multi_index<name("voterpool"), reggedvoter> voterpool_table;
 
-            // nominations table
+            // voter pool statistics table, one per shard
+            // scope: shard
+            TABLE poolstat {
+                uint32_t voters = 0;    // voters in the voter pool
+                EOSLIB_SERIALIZE(poolstat, (voters))
+            };
+            typedef singleton<name("poolstats"), poolstat> poolstats_singleton;
+
+            // voter sync progress table, one row per shard
+            // Every election walks the voter pool on its own, so overlapping elections don't interfere.
+            // scope: ballot
+            TABLE syncstate {
+                uint64_t shard;
+                name cursor;            // last voter scanned
+                uint32_t synced = 0;    // voters scanned
+                bool done = false;      // all voters of the shard scanned
+                name presync_cursor;    // last voter scanned by the rolling pre-sync while voting is open
+                uint64_t primary_key() const { return shard; }
+                EOSLIB_SERIALIZE(syncstate, (shard)(cursor)(synced)(done)(presync_cursor))
+            };
+            typedef multi_index<name("syncstates"), syncstate> syncstates_table;
+
+            // registration queue table
+            // Voters waiting to be registered by drainqueue(), paid by the voters
             // scope: self
+            TABLE queuedvoter {
+                name voter;
+                uint64_t primary_key() const { return voter.value; }
+                EOSLIB_SERIALIZE(queuedvoter, (voter))
+            };
+            typedef multi_index<name("regqueue"), queuedvoter> regqueue_table;
+
+            // nominations table
+            // Rows are paid by the nominator, accepting moves the payment to the nominee.
+            // scope: ballot
             TABLE nomination {
                 name nominee;
                 bool accepted;
@@ -146,37 +364,270 @@ namespace oigspace {
             };
             typedef multi_index<name("nominations"), nomination> nominations_table;
 
+            // candidates table
+            // Accepted nominations, maintained by nominate() and proclaim(), paid by the nominees.
+            // Paged by state_refresh() to set up the ballot without walking the nominations.
+            // scope: ballot
+            TABLE candidate {
+                name nominee;
+                uint64_t primary_key() const { return nominee.value; }
+                EOSLIB_SERIALIZE(candidate, (nominee))
+            };
+            typedef multi_index<name("candidates"), candidate> candidates_table;
+
             // nominees table
-            // scope: self
+            // Compact nominee record, large text fields are kept in the profiles table
+            // scope: ballot
             TABLE nominee {
                 name owner;
                 string name;        // max length   99 chars
+                uint8_t flags = 0;  // PROFILE_FLAG if a profile is stored
+                auto primary_key() const { return owner.value; }
+                EOSLIB_SERIALIZE(nominee, (owner)(name)(flags))
+            };
+            typedef multi_index<name("nominees"), nominee> nominees_table;
+
+            // profiles table
+            // scope: ballot
+            TABLE profile {
+                name owner;
                 string descriptor;  // max length 2000 chars
                 string picture;     // max length  256 chars (Needs to be an URL)
                 string telegram;    // max length   99 chars
                 string twitter;     // max length   99 chars
                 string wechat;      // max length   99 chars
                 auto primary_key() const { return owner.value; }
-                EOSLIB_SERIALIZE(nominee, (owner)(name)(descriptor)(picture)(telegram)(twitter)(wechat))
+                EOSLIB_SERIALIZE(profile, (owner)(descriptor)(picture)(telegram)(twitter)(wechat))
             };
-            typedef multi_index<name("nominees"), nominee> nominees_table;
+            typedef multi_index<name("profiles"), profile> profiles_table;
+
+            // keepers table
+            // scope: self
+            TABLE keeperinfo {
+                name keeper;
+                uint32_t cranks = 0; // productive crank() calls
+                uint64_t rows = 0;   // rows and state transitions processed
+                uint64_t primary_key() const { return keeper.value; }
+                EOSLIB_SERIALIZE(keeperinfo, (keeper)(cranks)(rows))
+            };
+            typedef multi_index<name("keepers"), keeperinfo> keepers_table;
+
+            // vote total of a ballot option
+            struct optiontally {
+                name option;
+                asset votes;
+                EOSLIB_SERIALIZE(optiontally, (option)(votes))
+            };
+
+            // results table
+            // Append-only archive of finished elections, written by onbroadcast() or endelection() before the cleanup
+            // scope: self
+            TABLE result {
+                name ballot;
+                vector<name> winners;       // options with the most votes, more than one on a tie
+                vector<optiontally> tally;  // all options, sorted by votes
+                uint32_t voters = 0;        // voters who voted on the ballot
+                asset total_votes;          // raw vote weight of all votes
+                time_point_sec closed;      // end of the voting period
+                uint64_t primary_key() const { return ballot.value; }
+                EOSLIB_SERIALIZE(result, (ballot)(winners)(tally)(voters)(total_votes)(closed))
+            };
+            typedef multi_index<name("results"), result> results_table;
+
+
+            //================================ external tables ================================
+            /*
+             *   Read-only views of tables owned by other contracts.
+             *   Only the leading fields needed by this contract are declared.
+             * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+            // decide voters table
+            // scope: voter
+            struct decidevoter {
+                asset liquid;
+                asset staked;   // stake synced into the treasury
+                uint64_t primary_key() const { return liquid.symbol.code().raw(); }
+                EOSLIB_SERIALIZE(decidevoter, (liquid)(staked))
+            };
+            typedef multi_index<name("voters"), decidevoter> decidevoters_table;
+
+            // decide votes table
+            // scope: voter
+            struct decidevote {
+                name ballot_name;
+                name registrant;
+                vector<name> selections;
+                asset raw_votes;    // vote weight at the time of voting or last rebalance
+                uint64_t primary_key() const { return ballot_name.value; }
+                EOSLIB_SERIALIZE(decidevote, (ballot_name)(registrant)(selections)(raw_votes))
+            };
+            typedef multi_index<name("votes"), decidevote> decidevotes_table;
+
+            // decide ballots table
+            // scope: decide
+            struct decideballot {
+                name ballot_name;
+                name category;
+                name publisher;
+                name status;
+                string title;
+                string description;
+                string content;
+                symbol treasury_symbol;
+                name voting_method;
+                uint8_t min_options;
+                uint8_t max_options;
+                map<name, asset> options;   // vote totals per option
+                uint32_t total_voters;
+                uint32_t total_delegates;
+                asset total_raw_weight;
+                uint64_t primary_key() const { return ballot_name.value; }
+                EOSLIB_SERIALIZE(decideballot, (ballot_name)(category)(publisher)(status)(title)(description)(content)
+                    (treasury_symbol)(voting_method)(min_options)(max_options)(options)(total_voters)(total_delegates)(total_raw_weight))
+            };
+            typedef multi_index<name("ballots"), decideballot> decideballots_table;
+
+            // eosio user resources table
+            // scope: owner
+            struct userres {
+                name owner;
+                asset net_weight;
+                asset cpu_weight;
+                uint64_t primary_key() const { return owner.value; }
+                EOSLIB_SERIALIZE(userres, (owner)(net_weight)(cpu_weight))
+            };
+            typedef multi_index<name("userres"), userres> userres_table;
             
 
 
 
 
 
+            //==================================== methods ====================================
+
+            /*
+             *   Synchronizes a batch of users vote stakes with their WAX stakes during an election.
+             * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+            void syncvoters(const vector<name>& voters, name ballot);
+
+            /*
+             *   Checks if a voter voted on the ballot with a stake differing from their current WAX stake.
+             * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+            bool needssync(name voter, name ballot);
+
+            /*
+             *   Scans up to batch voters of a shard behind cursor and syncs those needing it.
+             *   Returns true once the end of the shard is reached.
+             * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+            bool scanvoters(name ballot, uint64_t shard, name& cursor, uint16_t batch, uint16_t& scanned);
+
+            /*
+             *   Synchronizes the next config.sync_batch voters of a voter pool shard for a ballot.
+             *   Returns false if the shard is already fully synced.
+             * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+            bool syncbatch(name ballot, uint64_t shard);
+
+            /*
+             *   Syncs the next config.presync_batch voters of the rolling pre-sync while voting is open.
+             *   Returns true if elect was changed.
+             * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+            bool presync(election& elect);
+
+            /*
+             *   Election contract core logic. Progresses the election through it's stages.
+             *   Returns true if the election record got changed and needs to be written.
+             *   Consult source documentation for further clarification.
+             * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+            bool state_refresh(election& elect);
+
+            /*
+             *   Writes the final tally of a concluded election from decide into the results table.
+             * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+            void archive(const election& elect);
+
+            /*
+             *   Checks the length caps and format of a nominee info field, see FIELD_NAME to FIELD_WECHAT.
+             * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+            static void checkfield(uint8_t field, const string& value);
+
+            /*
+             *   Adds an accepted nomination to the candidates of a ballot or removes it.
+             * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+            void setcandidate(name ballot, name nominee, bool accepted);
+
+            /*
+             *   Writes an election record, erases it once it is cleaned up (elect.state == 0).
+             * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+            void storeelect(elections_table& elections, const election& elect);
+
+            /*
+             *   Erases up to config.cleanup_batch rows of election data. Sets elect.state to 0 once all data is gone.
+             *   Returns true once the cleanup is finished.
+             * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+            bool cleanbatch(election& elect);
+
+            /*
+             *   Registers up to config.reg_batch queued voters with decide.
+             * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+            void drainqueue();
+
+            /*
+             *   Adds a voter to the voter pool, paid by payer, and counts it in the poolstats of its shard.
+             *   Returns false if already pooled.
+             * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+            bool poolvoter(name voter, name payer);
+
+            /*
+             *   Sends the inline logstate() action for a state transition or processed batch.
+             * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+            void logbatch(name ballot, uint8_t old_state, uint8_t new_state, uint32_t rows);
+
+            /*
+             *   Returns the config, read once per action.
+             * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+            const config& getconfig();
+
+            uint32_t processed = 0; // rows and state transitions processed by the current action
+            config config_cache;        // cached by getconfig()
+            bool config_loaded = false; // config_cache was read in the current action
+
+
+
             //==================================== structs ====================================
             /*
              *   Partly prefilled structs for inline action execution
+             *   Actions sent in loops are packed once, setname() patches the changing name in the payload.
              * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+            static constexpr size_t VOTER_OFFSET = 0;   // byte offset of voter in RegVoter, VoterArg and RebalArg
+            static constexpr size_t OPTION_OFFSET = 8;  // byte offset of option in OptionArguments
+
+            // overwrites a name in the packed payload of an action, names are packed as 8 byte little endian
+            static void setname(action& act, size_t offset, name value) {
+                memcpy(act.data.data() + offset, &value.value, sizeof(value.value));
+            }
+
             struct BallotFeeArguments { // eosio.token::transfer
-                name sender = name("oig");
-                name reciever = name("decide");
-                asset quanitity = asset(3000000000, WAX_SYM); // ballot fee payment
+                name sender;    // set to get_self() when sending
+                name reciever = DECIDE;
+                asset quanitity = asset(BALLOT_FEE, WAX_SYM); // ballot fee payment
                 string memo = string("Ballot Fee Payment");
             };
 
+            struct RewardArguments { // eosio.token::transfer
+                name sender;    // set to get_self() when sending
+                name reciever;
+                asset quantity;
+                string memo = string("Crank Reward");
+            };
+
+            struct LogArguments { // oig::logstate
+                name ballot;
+                uint8_t old_state;
+                uint8_t new_state;
+                uint32_t rows;
+                time_point_sec time;
+            };
+
             struct NewBallotArguments { //decide::newballot
                 name ballot;
                 name category = name("election");
@@ -193,6 +644,11 @@ namespace oigspace {
                 string content;
             };
 
+            struct OptionArguments { // decide::addoption
+                name ballot;
+                name option;        // option to be added to the ballot
+            };
+
             struct ToggleArguments { // decide::togglebal
                 name ballot;
                 name toggle = name("votestake"); // Count only staked tokens
@@ -205,13 +661,13 @@ namespace oigspace {
 
             struct CloseArguments { // decide::closevoting
                 name ballot;        // ballot to close
-                bool broadcast = false; // allows to broadcast the results to be caught and handled
+                bool broadcast = true;  // broadcast the results to be caught by onbroadcast()
             };
 
             struct RegVoter { //decide::regvoter
                 name voter; 
                 symbol treasury_symbol = VOTE_SYM; // fixed (8,VOTE)
-                name referrer = name("oig"); // needed as (8,VOTE) is private to enforce voter logging
+                name referrer; // get_self(), needed as (8,VOTE) is private to enforce voter logging
             };
 
             struct VoterArg { //decide::sync
@@ -221,7 +677,7 @@ namespace oigspace {
             struct RebalArg { //decide:rebalance
                 name voter;
                 name ballot;
-                name worker = name("oig");
+                name worker;    // set to get_self() when sending
             };
             
         };
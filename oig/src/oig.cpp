@@ -4,8 +4,7 @@ using namespace oigspace;
 
 /*  
  *  
- *  Contract states:  elect.state ==  10  - contract not initialized
- *                    elect.state ==  00  - contract clean
+ *  Election states:  elect.state ==  00  - election cleaned, the record is erased
  *                    elect.state ==  01  - election created
  *                    elect.state ==  02  - nomination in progress
  *                    elect.state ==  03  - nomination closed
@@ -13,52 +12,110 @@ using namespace oigspace;
  *                    elect.state ==  05  - voting commenced
  *                    elect.state ==  06  - cleanup initiated
  * 
+ *  
+ *  Every election is a row of the elections table keyed by its ballot, its nominations, nominees
+ *  and profiles are scoped by the ballot. Elections progress independently and can overlap.
  * * * */
 
 /*
  * init():  Registers the contract as voter on decide to allow it to create ballots.
- *          Sets the contract state to clean.
+ *          Marks the contract as initialized.
+ *          Upgraded deployments are migrated: the last ballot of the old election singleton seeds
+ *          globalstate.last_ballot, so new ballot names don't collide with ballots decide already
+ *          has, and the old singleton is removed. The decide registration is skipped if decide 
+ *          already knows the contract.
  * authorisation: admin
  * requirements:
  *    Decide needs to be initialized. 
  *    The main treasury (8,VOTE) created and managed by get_self().
  *    To prevent 'doublespending' of votes the treasury needs to be private.
  *    eosio.code permission
+ *    An old election needs to be cleaned up before upgrading.
+ *    The voters of an old deployment need to be moved into the voter pool by migrate().
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 ACTION oig::init(){
   require_auth( get_self() );
-  // create the election singleton that tracks election states and registered voters
-  election_singleton elections(get_self(), get_self().value);
-  auto elect = elections.get_or_create(get_self());
+  // create the contract state singleton
+  globalstate_singleton globals(get_self(), get_self().value);
+  auto global = globals.get_or_default();
   // initi fails if ran more than once
-  check(elect.state == 10, "Contract already initialized.");
+  check(!global.initialized, "Contract already initialized.");
+  // migrate the state of an upgraded deployment
+  legacyelection_singleton legacy(get_self(), get_self().value);
+  if (legacy.exists()) {
+    auto old = legacy.get();
+    check(old.state == 0 || old.state == 10, "Clean up the old election before upgrading.");
+    check(old.voter.empty() && old.synced_voter.empty(), "Legacy voters left, run migrate() first.");
+    global.last_ballot = old.ballot;
+    legacy.remove();
+  }
   // registering the contract as voter with decide
-  RegVoter args;
-  args.voter = get_self();
-  permission_level permissionLevel = permission_level(get_self(), name("active"));
-  action transferAction = action(
-      permissionLevel,
-      name("decide"),
-      name("regvoter"),
-      std::move(args)
-  );
-  transferAction.send();
+  decidevoters_table dvoters(DECIDE, get_self().value);
+  if (dvoters.find(VOTE_SYM.code().raw()) == dvoters.end()) {
+    RegVoter args;
+    args.voter = get_self();
+    args.referrer = get_self();
+    permission_level permissionLevel = permission_level(get_self(), name("active"));
+    action transferAction = action(
+        permissionLevel,
+        DECIDE,
+        name("regvoter"),
+        std::move(args)
+    );
+    transferAction.send();
+  }
   
-  elect.state = 0; // setting election state to clean
-  elections.set(elect, get_self());
+  global.initialized = true;
+  globals.set(global, get_self());
+}
+
+/*
+ * migrate():  Moves the voters of a deployment before multiple elections into the voter pool.
+ *             Old deployments tracked their voters in the vectors of the election singleton and flagged
+ *             them in the old reggedvoters table, scoped by the voter. All of them were registered with 
+ *             decide on regvoter(), so they are added to the pool directly, skipping the registration queue.
+ *             Their pool rows are paid by the contract, as the erased flags were.
+ *             Without the migration these voters could still vote, but would never be synced.
+ * 
+ * authorisation: admin
+ * requirements:
+ *    Contract not initialized, the old election singleton exists and still holds voters.
+ * 
+ * arguments:
+ *    uint16_t count: maximum voters moved per call, repeat until "All legacy voters migrated."
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+ACTION oig::migrate(uint16_t count) {
+  require_auth( get_self() );
+  check(count > 0, "count needs to be positive");
+  legacyelection_singleton legacy(get_self(), get_self().value);
+  check(legacy.exists(), "Nothing to migrate.");
+  auto old = legacy.get();
+  check(!old.voter.empty() || !old.synced_voter.empty(), "All legacy voters migrated.");
+
+  uint16_t i = 0;
+  while (i < count && (!old.voter.empty() || !old.synced_voter.empty())) {
+    auto& list = old.voter.empty() ? old.synced_voter : old.voter;
+    name voter = list.back();
+    list.pop_back();
+    poolvoter(voter, get_self());
+    // erase the old registration flag
+    legacyvoters_table legacyvoters(get_self(), voter.value);
+    auto flag = legacyvoters.find(get_self().value);
+    if (flag != legacyvoters.end()) legacyvoters.erase(flag);
+    i++;
+  }
+  legacy.set(old, get_self());
+  logmsg<LOG_DEBUG>("migrated ", i, " voters, ", old.voter.size() + old.synced_voter.size(), " left");
 }
 
 
 /*
- * inaugurate() initializes or cancels the election process
+ * inaugurate() creates a new election, it gets the next ballot key.
  * 
  * authorisation: admin
  * requirements:
- *    For creation the contract needs to be in a clean state: elect.state == 0
- *    The contract needs to hold 30 WAX to pay the ballot creation fee.
- *    Elections can be cancelled until the ballot is created: elect.state <= 2
- *    Cancelling an election sets it into cleanup state. To clean the election call
- *    updtstate(). Depending on voter count updtstate() might need to be called multiple times.
+ *    The contract needs to be initialized.
+ *    The contract needs to hold 30 WAX per election to pay the ballot creation fee.
  * 
  * arguments:
  *    string title: Election title  string description: Election description
@@ -67,54 +124,67 @@ ACTION oig::init(){
  *    time_point_sec vote_open, vote_close: Voting window.
  *      Timestamps need to be provided in UTC as:
  *      YYYY-MM-DDTHH:MM:SS - 2020-12-31T00:00:00
- *    boolean cancel: elections can be cancelled during nomination
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 ACTION oig::inaugurate( string title, string description, string content, time_point_sec nmn_open, 
-                        time_point_sec nmn_close, time_point_sec vote_open, time_point_sec vote_close, bool cancel) {
+                        time_point_sec nmn_close, time_point_sec vote_open, time_point_sec vote_close) {
   // authorize
   require_auth( get_self() );
   // initialize
-  election_singleton elections(get_self(), get_self().value);
-  auto elect = elections.get_or_default();
+  globalstate_singleton globals(get_self(), get_self().value);
+  auto global = globals.get_or_default();
   // check contract state
-  check(elect.state != 10, "Contract not initialized.");
-
-  if (cancel) {
-    // cancellation is limited to the setup and nomination phase to prevent abandoned ballots in decide
-    check(elect.state <= 2, "Can't cancel once ballot is created.");
-    check(elect.state != 0, "No Election running.");
-    uint64_t tmp_ballot = elect.ballot.value;
-    tmp_ballot--; // resetting the ballot key
-    elect.ballot = name(tmp_ballot);
-    elect.state = 6; // setting to cleanup state
-    elections.set(elect, get_self());
-
-  } else {
-    check(elect.state != 5 , "Cleanup required."); // if in state 5, run endelection() to initialize cleaning
-    check(elect.state != 6 , "Cleanup in progress."); // if stuck in 6, run updstate(), updstate() calls cleanup
-    check(elect.state == 0 , "Election already running.");
-    check(!title.empty(), "title required");
-    check(!description.empty(), "description required");
-    auto now = time_point_sec(current_time_point());
-    check(now <= nmn_open, "dates need to be in the future");
-    check(nmn_open < nmn_close, "nomination duration needs to be positive");
-    check(nmn_close < vote_open, "voting period can't overlap with nomination period");
-    check(vote_open < vote_close, "voting duration needs to be positive");
-
-    uint64_t tmp_ballot = elect.ballot.value;
-    tmp_ballot++; // setting the ballot primary key
+  check(global.initialized, "Contract not initialized.");
+  // validate
+  check(!title.empty(), "title required");
+  check(!description.empty(), "description required");
+  auto now = time_point_sec(current_time_point());
+  check(now <= nmn_open, "dates need to be in the future");
+  check(nmn_open < nmn_close, "nomination duration needs to be positive");
+  check(nmn_close < vote_open, "voting period can't overlap with nomination period");
+  check(vote_open < vote_close, "voting duration needs to be positive");
+
+  uint64_t tmp_ballot = global.last_ballot.value;
+  tmp_ballot++; // setting the ballot primary key
+  global.last_ballot = name(tmp_ballot);
+  globals.set(global, get_self());
+
+  elections_table elections(get_self(), get_self().value);
+  elections.emplace(get_self(), [&](auto& col) {
+    col.ballot      = global.last_ballot;
+    col.state       = 1;
+    col.title       = title;
+    col.description = description;
+    col.content     = content;
+    col.nmn_open    = nmn_open;
+    col.nmn_close   = nmn_close;
+    col.vote_open   = vote_open;
+    col.vote_close  = vote_close;
+  });
+}
 
-    elect.ballot      = name(tmp_ballot);
-    elect.state       = 1;
-    elect.title       = title;
-    elect.description = description;
-    elect.content     = content;
-    elect.nmn_open    = nmn_open;
-    elect.nmn_close   = nmn_close;
-    elect.vote_open   = vote_open;
-    elect.vote_close  = vote_close;
-    elections.set(elect, get_self());
-  }
+/*
+ * cancel() cancels an election before its ballot is created.
+ * 
+ * authorisation: admin
+ * requirements:
+ *    Elections can be cancelled until the ballot is created: elect.state <= 2 and no candidates added.
+ *    Cancelling an election sets it into cleanup state. To clean the election call
+ *    updtstate(). Depending on nomination count updtstate() might need to be called multiple times.
+ * 
+ * arguments:
+ *    name ballot: election to cancel, its ballot key is not reused
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+ACTION oig::cancel(name ballot) {
+  // authorize
+  require_auth( get_self() );
+  // initialize
+  elections_table elections(get_self(), get_self().value);
+  auto elect = elections.get(ballot.value, "Election not found.");
+  // cancellation is limited to the setup and nomination phase to prevent abandoned ballots in decide
+  check(elect.state <= 2, "Can't cancel once ballot is created.");
+  check(elect.nmn_added == 0, "Can't cancel once ballot is created."); // candidates are being added
+  elect.state = 6; // setting to cleanup state
+  storeelect(elections, elect);
 }
 
 
@@ -126,67 +196,56 @@ ACTION oig::inaugurate( string title, string description, string content, time_p
  * 
  * authorisation: nominator
  * requirements:
- *    nomination needs to be in progress (elect.state == 1 || 2)
- *    To cope with possible nomination spam are limited to 200.
- *    If nominations ever exceed 200 the contract will remove all unaccepted nominations.
- *    If nomintations exceed 150 self nominations are not accepted automatically anymore.
+ *    nomination needs to be in progress (elect.state == 1 || 2) and the ballot setup not started.
  * 
  * arguments:
+ *    name ballot:      election to nominate for
  *    name nominator:   account signing the transaction
  *    name nominee:     account to be nominated
  * 
  * TODO:
- *    Eliminate nominations cap. 
  *    Change scope of nomination to nominee.
  *    Write cleanup for new nomination structure.
  *    Incorporate into front-end.
  *    Implement a nomination fee. (?)
  * 
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
-ACTION oig::nominate(name nominator, name nominee) {
+ACTION oig::nominate(name ballot, name nominator, name nominee) {
   //authenticate
   require_auth( nominator );
   //initialize
-  election_singleton elections(get_self(), get_self().value);
-  auto elect = elections.get();
+  elections_table elections(get_self(), get_self().value);
+  auto elect = elections.get(ballot.value, "Election not found.");
   //verify
-  check(elect.state != 0, "No election is currently running.");
   check(elect.state <= 2, "Nomination period has already closed.");
+  // candidates are frozen once they are being added to the ballot in batches, until then late
+  // nominations are taken, so an election short of candidates at the deadline can still start
+  check(elect.nmn_added == 0, "Nomination period has already closed.");
   //get data
-  nominations_table nominations(get_self(), get_self().value);
+  nominations_table nominations(get_self(), ballot.value);
   auto nmne_itr = nominations.find(nominee.value);
   //verify
   check(nmne_itr == nominations.end(), "Nomination already exists.");
   check(is_account(nominee), "Nominated account must exist.");
 
-  // dirty spam prevention
-  uint8_t count = elect.nom_count;
-  if (count > 200) {
-    auto nomn = nominations.begin();
-    while ( nomn != nominations.end()) {
-      if (!nomn->accepted) {
-        nomn = nominations.erase(nomn);
-        count--;
-      } else {
-        ++nomn;
-      }
-    }
-    elect.nom_count = count;
-  }
   // auto-accept self nominations
   bool accepted = 0;
-  if (nominator == nominee && count < 150) {
+  if (nominator == nominee) {
     accepted = 1;
   }
   //emplace new nominee
-  nominations.emplace(get_self(), [&](auto& col) {
+  nominations.emplace(nominator, [&](auto& col) { // the nominator pays for the nomination
     col.nominee = nominee;
     col.accepted = accepted;
   });
   // track nominations count
-  elect.nom_count = ++count;
-  elections.set(elect, get_self());
-  state_refresh(); // call state_refresh() to progress in election if needed
+  elect.total_nominations++;
+  if (accepted) {
+    elect.accepted_nominations++;
+    setcandidate(ballot, nominee, true);
+  }
+  state_refresh(elect); // call state_refresh() to progress in election if needed
+  storeelect(elections, elect); // write changes once
 }
 
 /*
@@ -195,50 +254,70 @@ ACTION oig::nominate(name nominator, name nominee) {
  * 
  * authorisation: nominee
  * requirements:  
- *    Nomination needs to be in progress (elect.state == 1 || 2)
+ *    Nomination needs to be in progress (elect.state == 1 || 2) and the ballot setup not started.
  *    nominee account needs to exist.
  *    nominee must not be nominated already.
  * 
  * arguments:
+ *    name ballot:    election of the nomination
  *    name nominee:   nomination in question
  *    bool decision:  accepted || declined
  * 
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
-ACTION oig::proclaim(name nominee, bool decision) {
+ACTION oig::proclaim(name ballot, name nominee, bool decision) {
   // authenticate
   require_auth( nominee );
   // initialize
-  election_singleton elections(get_self(), get_self().value);
-  auto elect = elections.get();
+  elections_table elections(get_self(), get_self().value);
+  auto elect = elections.get(ballot.value, "Election not found.");
   // verify
-  check(elect.state != 0, "No election is currently running.");
   check(elect.state <= 2, "Nomination period has alreaedy closed.");
+  check(elect.nmn_added == 0, "Nomination period has already closed."); // candidates are being added
   // get data
-  nominations_table nominations(get_self(), get_self().value);
+  nominations_table nominations(get_self(), ballot.value);
   auto& nmne = nominations.get(nominee.value, "Nomination not found.");
+  bool dirty = false; // tracks changes to the election record
 
   if (decision) {
+    if (!nmne.accepted) { // only count first acceptance
+      elect.accepted_nominations++;
+      setcandidate(ballot, nominee, true);
+      dirty = true;
+    }
     nominations.modify(nmne, nominee, [&](auto& col) {
         col.accepted = decision;
-        printf("Nomination accepted!");
     });
+    logmsg<LOG_DEBUG>("nomination accepted ", ballot, " ", nominee);
   } else { // erase nomination if declined
+    if (nmne.accepted) {
+      elect.accepted_nominations--;
+      setcandidate(ballot, nominee, false);
+    }
+    elect.total_nominations--;
+    dirty = true;
     nominations.erase(nmne);
-    printf("Nomination declined!");
-    elect.nom_count = --elect.nom_count;
-    elections.set(elect, get_self());
+    logmsg<LOG_DEBUG>("nomination declined ", ballot, " ", nominee);
     // doublecheck if the nominee has already given info and delete if needed.
-    nominees_table nominees(get_self(), get_self().value);
+    nominees_table nominees(get_self(), ballot.value);
     auto desc = nominees.find(nominee.value);
     if (desc != nominees.end()) {
+        if (desc->flags & PROFILE_FLAG) { // only touch the profiles if one was given
+          profiles_table profiles(get_self(), ballot.value);
+          profiles.erase(profiles.get(nominee.value, "Profile not found."));
+        }
         nominees.erase(desc);
     }
   }
-  state_refresh(); // call state_refresh() to progress in election if needed
+  dirty |= state_refresh(elect); // call state_refresh() to progress in election if needed
+  if (dirty) {
+    storeelect(elections, elect); // write changes once
+  }
 }
 
 /*
  * nominf() Allows nominees to provide personal info or delete given info.
+ *          The name is stored with the nominee, all other info in a separate profile.
+ *          Profiles are only stored if at least one of its fields is given.
  * 
  * authorisation: nominee
  * requirements:
@@ -246,6 +325,7 @@ ACTION oig::proclaim(name nominee, bool decision) {
  *    Nomination needs to exist and be accepted.
  *      
  * arguments:
+ *    name ballot: election of the nomination
  *    name nominee: nominee account     string name: Plain text name. cap 99 chars
  *    string descriptor: candidates representation. cap 2000 chars
  *    string picture: url to a picture. cap 256 chars
@@ -254,78 +334,450 @@ ACTION oig::proclaim(name nominee, bool decision) {
  * TODO: check if there is a combined modify or emplace function.
  * 
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
-ACTION oig::nominf(name nominee, string name, string descriptor, string picture, string telegram, string twitter, string wechat, bool remove) {
+ACTION oig::nominf(name ballot, name nominee, string name, string descriptor, string picture, string telegram, string twitter, string wechat, bool remove) {
     // authenticate
     require_auth( nominee );
     // initilize
-    election_singleton elections(get_self(), get_self().value);
-    auto elect = elections.get();
+    elections_table elections(get_self(), get_self().value);
+    auto elect = elections.get(ballot.value, "Election not found.");
     // verify 
     check(elect.state <= 3, "Voting has already commenced.");
 
     //doublecheck if the nominee exists and accepted
-    nominations_table nominations(get_self(), get_self().value);
+    nominations_table nominations(get_self(), ballot.value);
     auto nmne_itr = nominations.require_find(nominee.value, "Account not nominated.");
     check(nmne_itr->accepted, "Nomination not accepted.");
     // fetching possible existing entry
-    nominees_table nominees(get_self(), get_self().value);
+    nominees_table nominees(get_self(), ballot.value);
+    profiles_table profiles(get_self(), ballot.value);
     auto nmne = nominees.find(nominee.value);
+    bool had_profile = nmne != nominees.end() && (nmne->flags & PROFILE_FLAG);
 
     if (remove) { // if 'remove' just skip everything and delete the record.
         check(nmne != nominees.end(), "can't delete non-existing record");
+        if (had_profile) {
+          profiles.erase(profiles.get(nominee.value, "can't delete non-existing profile"));
+        }
         nominees.erase(nmne);
     } else {
       // validate
-      check(!name.empty(), "name required");
-      check(name.length() <= 99, "name too long");
-      check(descriptor.length() <= 2000, "description too long");
-      check(picture.length() <= 256, "picture too long");
-      if (!picture.empty()) check(picture.substr(0, 4) == "http", "picture should begin with http");
-      check(telegram.length() <= 99, "telegram too long");
-      check(twitter.length() <= 99, "twitter too long");
-      check(wechat.length() <= 99, "wechat too long");
+      checkfield(FIELD_NAME, name);
+      checkfield(FIELD_DESCRIPTOR, descriptor);
+      checkfield(FIELD_PICTURE, picture);
+      checkfield(FIELD_TELEGRAM, telegram);
+      checkfield(FIELD_TWITTER, twitter);
+      checkfield(FIELD_WECHAT, wechat);
+      bool has_profile = !descriptor.empty() || !picture.empty() || !telegram.empty() || !twitter.empty() || !wechat.empty();
+      uint8_t flags = has_profile ? PROFILE_FLAG : 0;
       // create if new entry
       if (nmne == nominees.end()) {
          nominees.emplace(nominee, [&](auto& col) {
             col.owner = nominee;
             col.name = name;
+            col.flags = flags;
+         });
+      } else { // modify if record exists
+         nominees.modify(nmne, nominee, [&](auto& col) {
+            col.name = name;
+            col.flags = flags;
+         });
+      }
+      // keep the profile in line with the nominee record
+      if (has_profile && !had_profile) {
+         profiles.emplace(nominee, [&](auto& col) {
+            col.owner = nominee;
             col.descriptor = descriptor;
             col.picture = picture;
             col.telegram = telegram;
             col.twitter = twitter;
             col.wechat = wechat;
          });
-      } else { // modify if record exists
-         nominees.modify(nmne, nominee, [&](auto& col) {
-            col.owner = nominee;
-            col.name = name;
+      } else if (has_profile) {
+         profiles.modify(profiles.get(nominee.value, "Profile not found."), nominee, [&](auto& col) {
             col.descriptor = descriptor;
             col.picture = picture;
             col.telegram = telegram;
             col.twitter = twitter;
             col.wechat = wechat;
          });
+      } else if (had_profile) {
+         profiles.erase(profiles.get(nominee.value, "Profile not found."));
       }
    }
-   state_refresh(); // call state_refresh() to progress in election if needed
+   if (state_refresh(elect)) { // call state_refresh() to progress in election if needed
+      storeelect(elections, elect);
+   }
+}
+
+/*
+ * checkfield() Validates a nominee info field, shared by nominf() and nomfield() so both apply the same caps.
+ * 
+ * arguments:
+ *    uint8_t field: FIELD_NAME to FIELD_WECHAT     const string& value: content of the field
+ * 
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+void oig::checkfield(uint8_t field, const string& value) {
+  switch (field) {
+      case (FIELD_NAME):
+        check(!value.empty(), "name required");
+        check(value.length() <= 99, "name too long");
+        break;
+      case (FIELD_DESCRIPTOR):
+        check(value.length() <= 2000, "description too long");
+        break;
+      case (FIELD_PICTURE):
+        check(value.length() <= 256, "picture too long");
+        if (!value.empty()) check(value.substr(0, 4) == "http", "picture should begin with http");
+        break;
+      case (FIELD_TELEGRAM):
+        check(value.length() <= 99, "telegram too long");
+        break;
+      case (FIELD_TWITTER):
+        check(value.length() <= 99, "twitter too long");
+        break;
+      case (FIELD_WECHAT):
+        check(value.length() <= 99, "wechat too long");
+        break;
+      default:
+        check(false, "Unknown field.");
+  }
+}
+
+/*
+ * nomfield() Allows nominees to update a single field of their info.
+ *            Only the changed field is transmitted, updating the name doesn't touch the profile.
+ *            The name needs to be given first, profiles are created with the first non-empty field
+ *            and erased once all of their fields are empty.
+ * 
+ * authorisation: nominee
+ * requirements:
+ *    Voting not yet in progress. (elect.state <= 3)
+ *    Nomination needs to exist and be accepted.
+ *      
+ * arguments:
+ *    name ballot: election of the nomination   name nominee: nominee account
+ *    uint8_t field: FIELD_NAME, FIELD_DESCRIPTOR, FIELD_PICTURE, FIELD_TELEGRAM, FIELD_TWITTER or FIELD_WECHAT
+ *    string value: new content of the field, same caps as in nominf(). Empty to clear profile fields.
+ * 
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+ACTION oig::nomfield(name ballot, name nominee, uint8_t field, string value) {
+    // authenticate
+    require_auth( nominee );
+    // initilize
+    elections_table elections(get_self(), get_self().value);
+    auto elect = elections.get(ballot.value, "Election not found.");
+    // verify 
+    check(elect.state <= 3, "Voting has already commenced.");
+    check(field <= FIELD_WECHAT, "Unknown field.");
+
+    //doublecheck if the nominee exists and accepted
+    nominations_table nominations(get_self(), ballot.value);
+    auto nmne_itr = nominations.require_find(nominee.value, "Account not nominated.");
+    check(nmne_itr->accepted, "Nomination not accepted.");
+    // validate
+    checkfield(field, value);
+
+    nominees_table nominees(get_self(), ballot.value);
+    auto nmne = nominees.find(nominee.value);
+    if (field == FIELD_NAME) { // the name is the only field of the compact nominee record
+      if (nmne == nominees.end()) {
+         nominees.emplace(nominee, [&](auto& col) {
+            col.owner = nominee;
+            col.name = value;
+         });
+      } else {
+         nominees.modify(nmne, nominee, [&](auto& col) {
+            col.name = value;
+         });
+      }
+    } else {
+      check(nmne != nominees.end(), "name required, set it first");
+      // set the field on a profile row
+      auto setfield = [&](auto& col) {
+        switch (field) {
+            case (FIELD_DESCRIPTOR): col.descriptor = value; break;
+            case (FIELD_PICTURE):    col.picture = value;    break;
+            case (FIELD_TELEGRAM):   col.telegram = value;   break;
+            case (FIELD_TWITTER):    col.twitter = value;    break;
+            case (FIELD_WECHAT):     col.wechat = value;     break;
+        }
+      };
+      profiles_table profiles(get_self(), ballot.value);
+      auto prfl = profiles.find(nominee.value);
+      if (prfl == profiles.end()) {
+        if (!value.empty()) { // create the profile with its first field
+          profiles.emplace(nominee, [&](auto& col) {
+            col.owner = nominee;
+            setfield(col);
+          });
+          nominees.modify(nmne, nominee, [&](auto& col) {
+            col.flags |= PROFILE_FLAG;
+          });
+        }
+      } else {
+        profiles.modify(prfl, nominee, setfield);
+        if (prfl->descriptor.empty() && prfl->picture.empty() && prfl->telegram.empty() && 
+            prfl->twitter.empty() && prfl->wechat.empty()) { // erase empty profiles
+          profiles.erase(prfl);
+          nominees.modify(nmne, nominee, [&](auto& col) {
+            col.flags &= ~PROFILE_FLAG;
+          });
+        }
+      }
+    }
+    if (state_refresh(elect)) { // call state_refresh() to progress in election if needed
+      storeelect(elections, elect);
+    }
+}
+
+/*
+ * setconfig() Sets the batch sizes used to progress through the election.
+ *             Different API nodes bill CPU differently, batches might need to be reduced accordingly.
+ *             Until set, the defaults NMN_BATCH, SYNC_BATCH, CLEANUP_BATCH and REG_BATCH are used.
+ * 
+ * authorisation: admin
+ * requirements: none
+ * 
+ * arguments:
+ *    uint16_t nmn_batch:     nominations scanned per call when closing nominations
+ *    uint16_t sync_batch:    voters synchronized per call when closing the ballot
+ *    uint16_t cleanup_batch: rows erased per call during cleanup
+ *    uint16_t reg_batch:     queued voters registered per call
+ *    asset crank_reward:     WAX paid to keepers per row or state transition processed by crank(), 0 to disable
+ *    uint16_t presync_batch: voters pre-synced per call while voting is open, 0 to disable, see presync()
+ * 
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+ACTION oig::setconfig(uint16_t nmn_batch, uint16_t sync_batch, uint16_t cleanup_batch, uint16_t reg_batch, asset crank_reward, uint16_t presync_batch) {
+  // authorize
+  require_auth( get_self() );
+  // validate
+  check(nmn_batch > 0, "nmn_batch needs to be positive");
+  check(sync_batch > 0, "sync_batch needs to be positive");
+  check(cleanup_batch > 0, "cleanup_batch needs to be positive");
+  check(reg_batch > 0, "reg_batch needs to be positive");
+  check(crank_reward.symbol == WAX_SYM, "crank_reward needs to be paid in WAX");
+  check(crank_reward.amount >= 0, "crank_reward can't be negative");
+  // write config
+  config_singleton configs(get_self(), get_self().value);
+  auto conf = configs.get_or_default();
+  conf.nmn_batch     = nmn_batch;
+  conf.sync_batch    = sync_batch;
+  conf.cleanup_batch = cleanup_batch;
+  conf.reg_batch     = reg_batch;
+  conf.crank_reward  = crank_reward;
+  conf.presync_batch = presync_batch;
+  configs.set(conf, get_self());
+}
+
+/*
+ * updtstate()  Drains queued voter registrations and calls refresh_state() to progress in election if needed
+ * 
+ * authorisation: none
+ * requirements: none
+ * arguments:
+ *    name ballot: election to progress
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+ACTION oig::updtstate(name ballot) {
+  drainqueue(); // register queued voters independent of the election state
+  elections_table elections(get_self(), get_self().value);
+  auto elect = elections.get(ballot.value, "Election not found.");
+  if (state_refresh(elect)) {
+    storeelect(elections, elect);
+  }
 }
 
 /*
- * updtstate()  Calls refresh_state() to progress in election if needed
+ * drain()  Registers a batch of queued voters with decide, see drainqueue().
+ *          Independent of any election, so voters also get registered between elections.
  * 
  * authorisation: none
  * requirements: none
  * arguments: none
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
-ACTION oig::updtstate() {
-  state_refresh();
+ACTION oig::drain() {
+  drainqueue();
 }
 
 /*
- * regvoter()   Registers accounts as voters with decide in the (8,Vote) treasury if needed.
- *              Places a 'flag' for the account to keep track of it being registered.
- *              Adds the voter to one of the according tracking vectors, 
- *              to have their balances synced preventing 'doublespending' of votes if needed.
+ * crank()  Permissionless state progression for third party keepers.
+ *          Runs up to 'rounds' state_refresh() batches within one transaction, stopping early 
+ *          once no work is left. This allows keepers to finish multi batch stages (ballot creation,
+ *          voter sync, cleanup) as fast as their CPU allows instead of waiting for the next cron run.
+ *          Keepers are tracked in the keepers table and rewarded with config.crank_reward
+ *          WAX per processed row or state transition. Scaling the reward with the work keeps
+ *          single round calls from earning more than one call running all rounds, and pays
+ *          a drain of a single queued voter accordingly little.
+ *          With an empty ballot only the registration queue is drained, so keepers also
+ *          get rewarded for registering voters between elections, when no election exists.
+ * 
+ * authorisation: keeper
+ * requirements:
+ *    To pay rewards get_self() needs to hold enough WAX.
+ * 
+ * arguments:
+ *    name keeper:    account cranking the contract, pays for its keeper record
+ *    name ballot:    election to progress, empty to only drain the registration queue
+ *    uint8_t rounds: maximum amount of batches to run
+ * 
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+ACTION oig::crank(name keeper, name ballot, uint8_t rounds) {
+  // authorize
+  require_auth( keeper );
+  // validate
+  check(rounds > 0, "rounds need to be positive");
+  // register queued voters independent of the election state
+  drainqueue();
+  if (ballot != name()) {
+    // initialize
+    elections_table elections(get_self(), get_self().value);
+    auto elect = elections.get(ballot.value, "Election not found.");
+    bool dirty = false;
+    // run batches as long as there is work left
+    for (uint8_t i = 0; i < rounds; i++) {
+      uint32_t before = processed;
+      dirty |= state_refresh(elect);
+      if (processed == before) break;
+    }
+    if (dirty) {
+      storeelect(elections, elect);
+    }
+  }
+  if (processed == 0) return; // nothing to reward
+
+  // track the keepers work
+  keepers_table keepers(get_self(), get_self().value);
+  auto kpr = keepers.find(keeper.value);
+  if (kpr == keepers.end()) {
+    keepers.emplace(keeper, [&](auto& col) {
+      col.keeper = keeper;
+      col.cranks = 1;
+      col.rows = processed;
+    });
+  } else {
+    keepers.modify(kpr, same_payer, [&](auto& col) {
+      col.cranks++;
+      col.rows += processed;
+    });
+  }
+  // pay the reward if enabled
+  auto& conf = getconfig();
+  if (conf.crank_reward.amount > 0) {
+    RewardArguments reward;
+    reward.sender = get_self();
+    reward.reciever = keeper;
+    reward.quantity = asset(conf.crank_reward.amount * processed, WAX_SYM); // paid per processed row
+    action(
+        permission_level(get_self(), name("active")),
+        name("eosio.token"),
+        name("transfer"),
+        std::move(reward)).send();
+  }
+}
+
+/*
+ * logstate()  Records a state transition or processed batch in the action traces.
+ *             Called inline by state_refresh() only. It doesn't store anything, monitoring can 
+ *             compute stage latencies and throughput by filtering for oig::logstate.
+ * 
+ * authorisation: contract
+ * requirements: none
+ * 
+ * arguments:
+ *    name ballot: election ballot          uint8_t old_state, new_state: state before and after the call
+ *    uint32_t rows: rows and state transitions processed
+ *    time_point_sec time: block time of the call
+ * 
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+ACTION oig::logstate(name ballot, uint8_t old_state, uint8_t new_state, uint32_t rows, time_point_sec time) {
+  require_auth( get_self() );
+}
+
+/*
+ * syncshard()  Synchronizes a batch of voters of a single voter pool shard once voting ended.
+ *              The election record is only read, calls for different shards don't touch the same rows
+ *              and can be executed within the same block. The ballot is closed by the next state_refresh() 
+ *              once all shards are synced.
+ * 
+ * authorisation: none
+ * requirements:
+ *    Voting needs to have ended. (elect.state == 4 and elect.vote_close reached)
+ *    The shard needs to contain unsynced voters.
+ * 
+ * arguments:
+ *    name ballot: election to synchronize
+ *    uint64_t shard: voter pool shard, lower than VOTER_SHARDS
+ * 
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+ACTION oig::syncshard(name ballot, uint64_t shard) {
+  // validate
+  check(shard < VOTER_SHARDS, "Shard does not exist.");
+  // initialize
+  elections_table elections(get_self(), get_self().value);
+  auto elect = elections.get(ballot.value, "Election not found.");
+  check(elect.state == 4 && time_point_sec(current_time_point()) >= elect.vote_close, "Voting needs to have ended.");
+  // sync
+  check(syncbatch(elect.ballot, shard), "Shard already synced.");
+  logbatch(elect.ballot, elect.state, elect.state, processed);
+}
+
+/*
+ * getstats()  Returns the election progress counters as a small fixed size struct.
+ *             Unlike reading the tables it doesn't grow with the voter pool or nominations.
+ * 
+ * authorisation: none
+ * requirements: Election needs to exist.
+ * 
+ * arguments:
+ *    name ballot: election to report
+ * 
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+oig::electionstats oig::getstats(name ballot) {
+  elections_table elections(get_self(), get_self().value);
+  auto elect = elections.get(ballot.value, "Election not found.");
+
+  electionstats stats;
+  stats.ballot               = elect.ballot;
+  stats.state                = elect.state;
+  stats.voters               = 0;
+  stats.synced_voters        = 0;
+  stats.pending_voters       = 0;
+  syncstates_table syncstates(get_self(), ballot.value);
+  // estimate the RAM paid by the contract, voter, nomination, candidate, nominee and profile rows are paid by their actors
+  stats.contract_ram         = pack_size(elect) + ROW_OVERHEAD;
+  for (auto& sync : syncstates) {
+    stats.contract_ram += pack_size(sync) + ROW_OVERHEAD;
+  }
+  for (uint64_t shard = 0; shard < VOTER_SHARDS; shard++) { // sum up all shards
+    poolstats_singleton poolstats(get_self(), shard);
+    uint32_t voters = poolstats.get_or_default().voters;
+    stats.voters += voters;
+    auto sync = syncstates.find(shard);
+    if (sync == syncstates.end()) {
+      stats.pending_voters += voters; // sync not started
+    } else {
+      stats.synced_voters += sync->synced;
+      if (!sync->done && voters > sync->synced) stats.pending_voters += voters - sync->synced;
+    }
+  }
+  stats.total_nominations    = elect.total_nominations;
+  stats.accepted_nominations = elect.accepted_nominations;
+  stats.nmn_added            = elect.nmn_added;
+  switch (elect.state) { // the deadline that progresses the current state
+      case (1): stats.next_deadline = elect.nmn_open;   break;
+      case (2): stats.next_deadline = elect.nmn_close;  break;
+      case (3): stats.next_deadline = elect.vote_open;  break;
+      case (4): stats.next_deadline = elect.vote_close; break;
+      default:  stats.next_deadline = time_point_sec(); // no time based transition
+  }
+  return stats;
+}
+
+/*
+ * regvoter()   Adds accounts to the voter pool and queues them to be registered as voters with decide 
+ *              in the (8,Vote) treasury if needed. The queue is drained by drain(), updtstate() and crank(), 
+ *              see drainqueue(). Voters can vote once drained.
+ *              To keep registration bursts cheap, this neither touches the election nor calls decide.
+ *              The voter pays for their pool and queue rows, so contract RAM doesn't grow with registrations.
  * 
  * authorisation: voter
  * requirements:
@@ -343,106 +795,219 @@ ACTION oig::regvoter(name voter) {
   require_auth( voter );
   // validate
   check(is_account(voter), "Voter account must exist.");
-  // initialize
-  election_singleton elections(get_self(), get_self().value);
-  auto elect = elections.get();
-  // load table
-  reggedvoters_table reggedvoters(get_self(), voter.value);
-  // check if voter is already regged and skip further execution if needed
-  auto voter_itr = reggedvoters.find(get_self().value);
-  if (voter_itr == reggedvoters.end()) { // place a flag for new voters
-    reggedvoters.emplace(get_self(), [&](auto& col) { 
-      col.referrer = get_self();
-      col.treasury = VOTE_SYM;
-      col.voter = voter;
-    });
-    // set permission level for inline actions
-    permission_level permissionLevel = permission_level(get_self(), name("active"));
-    RegVoter reg;
-    reg.voter = voter; // prepare arguments for inline action
-    action regAction = action(
-      permissionLevel,
-      name("decide"), // contract to call
-      name("regvoter"), // function to call
-      std::move(reg));
-    regAction.send();
-    // based on vector state add the new voter to one of the trackers
-    if(!elect.synced_voter.empty()) {
-      if (elect.voter.size() != 0 ) {
-        elect.voter.push_back(voter);
-      } else {
-        elect.synced_voter.push_back(voter);
-      }
-    } else {
-      elect.voter.push_back(voter);
+  // add the new voter to the pool, it will be picked up by the syncs of running elections 
+  // once registered with decide, needssync() skips unregistered voters
+  // skip further execution if the voter is already regged
+  if (!poolvoter(voter, voter)) return;
+  // queue the registration with decide
+  regqueue_table regqueue(get_self(), get_self().value);
+  regqueue.emplace(voter, [&](auto& col) {
+    col.voter = voter;
+  });
+}
+
+/*
+ * drainqueue() Registers queued voters with decide, in batches of config.reg_batch per call.
+ *              The voters were added to the voter pool by regvoter(), to have their balances synced by 
+ *              every following election preventing 'doublespending' of votes if needed.
+ *              Erasing the queue rows refunds their RAM to the voters.
+ *              Voters decide already knows, e.g. from earlier deployments, are only dequeued, as
+ *              decide would reject their registration and block the queue.
+ *              Only called by drain(), updtstate() and crank(), never from user or notification paths.
+ * 
+ * requirements:
+ *    (8,VOTE) treasury needs to be created, private and managed by get_self().
+ * 
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+void oig::drainqueue() {
+  regqueue_table regqueue(get_self(), get_self().value);
+  auto qtr = regqueue.begin();
+  if (qtr == regqueue.end()) return; // nothing queued
+
+  uint16_t batch = getconfig().reg_batch;
+  // pack the registration once, only the voter is patched per call
+  RegVoter args;
+  args.referrer = get_self();
+  action reg = action(
+    permission_level(get_self(), name("active")),
+    DECIDE, // contract to call
+    name("regvoter"), // function to call
+    args);
+  uint16_t i = 0;
+
+  while (qtr != regqueue.end() && i < batch) {
+    name voter = qtr->voter;
+    decidevoters_table dvoters(DECIDE, voter.value);
+    if (dvoters.find(VOTE_SYM.code().raw()) == dvoters.end()) { // skip voters already registered with decide
+      setname(reg, VOTER_OFFSET, voter); // prepare arguments for inline action
+      reg.send();
     }
-    // write changes back to the election record
-    elections.set(elect, get_self());
+    qtr = regqueue.erase(qtr);
+    i++;
   }
+  processed += i;
 }
 
 /*
- * endelection() Sets an ended election into cleanup state and starts the cleanup process.
+ * poolvoter()  Adds a voter to its shard of the voter pool and counts it in the shard's poolstats.
+ *              Counting with the pool row keeps getstats() on one base: the syncs scan queued voters
+ *              right away, so they are part of the pool size before decide registered them.
+ * 
+ * arguments:
+ *    name voter: account to add    name payer: pays for the pool row
+ * 
+ * returns false if the voter is already pooled.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+bool oig::poolvoter(name voter, name payer) {
+  voterpool_table pool(get_self(), voter_shard(voter));
+  if (pool.find(voter.value) != pool.end()) return false;
+  pool.emplace(payer, [&](auto& col) {
+    col.voter = voter;
+    col.referrer = get_self();
+    col.treasury = VOTE_SYM;
+  });
+  // track the pool size, read by getstats()
+  poolstats_singleton poolstats(get_self(), voter_shard(voter));
+  auto stats = poolstats.get_or_default();
+  stats.voters++;
+  poolstats.set(stats, get_self());
+  return true;
+}
+
+/*
+ * endelection() Archives the results of an ended election, sets it into cleanup state and starts 
+ *               the cleanup process. See archive().
  * 
  * authorisation: admin
  * requirements:  Voting needs to have concluded. (elect.state == 5)
  * 
- * arguments: none
+ * arguments:
+ *    name ballot: election to end
  * 
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
-ACTION oig::endelection() {
+ACTION oig::endelection(name ballot) {
   // authorize
   require_auth( get_self() );
   // initialize
-  election_singleton elections(get_self(), get_self().value);
-  auto elect = elections.get();
+  elections_table elections(get_self(), get_self().value);
+  auto elect = elections.get(ballot.value, "Election not found.");
   // validate
   check(elect.state == 5, "Voting needs to have concluded.");
+  archive(elect); // keep the results before the election data is cleaned
   elect.state = 6; // set cleanup state
-  elections.set(elect, get_self()); // write changes
-  state_refresh(); // start cleanup
+  state_refresh(elect); // start cleanup
+  storeelect(elections, elect); // write changes
 }
 
 
+/*
+ * onbroadcast() Finalizes an election once decide broadcasts the results of its closed ballot.
+ *               The broadcast is sent by decide::closevoting, which state_refresh() calls once all voters
+ *               are synced. As it executes after the rebalances of the sync, the tally is final.
+ *               Archives the results and moves the election into cleanup, without waiting for endelection().
+ *               Runs inside decide's closevoting transaction, so a failure here would revert closing the ballot.
+ *               Cleanup is therefore left to the next updtstate() or crank() call.
+ *               endelection() remains as fallback, for ballots closed without broadcast.
+ * 
+ * authorisation: decide
+ * requirements:  
+ *    The notification needs to originate from DECIDE.
+ *    Broadcasts for ballots not hosted by this contract or not in state 5 are ignored.
+ * 
+ * arguments:
+ *    name ballot_name: closed ballot    map<name, asset> final_results: vote totals per option
+ *    uint32_t total_voters: voters of the ballot
+ * 
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+void oig::onbroadcast(name ballot_name, map<name, asset> final_results, uint32_t total_voters) {
+  // only decide can publish results
+  if (get_first_receiver() != DECIDE) return;
+  // initialize
+  elections_table elections(get_self(), get_self().value);
+  auto itr = elections.find(ballot_name.value);
+  if (itr == elections.end() || itr->state != 5) return; // not an election of ours
+  auto elect = *itr;
+  archive(elect); // keep the results before the election data is cleaned
+  elect.state = 6; // set cleanup state, cleaned by the next updtstate() or crank()
+  storeelect(elections, elect); // write changes
+}
+
 //======================= utility methods ============================//
 
 /*
- * syncvoter()  Called for every registered voter after the voting period ended before
- *              the ballot is closed. Syncronizes the vote balance of a user to his token stake.
- *              Rebalances the ballot according to the new stake.
+ * syncvoters() Called for every batch of registered voters after the voting period ended before
+ *              the ballot is closed. Syncronizes the vote balances of the users to their token stake.
+ *              Rebalances the ballot according to the new stakes.
+ *              Decide only offers per voter sync and rebalance actions, so the batch is dispatched
+ *              as all syncs followed by all rebalances. Each action is packed once per batch,
+ *              every call only patches the voter name in the packed payload.
  *              
  * requirements:
  *    (8,VOTE) treasury needs to exist.
- *    voter needs to exist and be registered as voter.
+ *    voters need to exist and be registered as voter.
  *    ballot needs to exist and not be closed or archived.
  * 
  * arguments:
- *    name voter: account to be synchronized    name ballot:  ballot that is currently voted on
+ *    vector<name> voters: accounts to be synchronized    name ballot:  ballot that is currently voted on
  * 
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
-void oig::syncvoter (name voter, name ballot){
+void oig::syncvoters (const vector<name>& voters, name ballot){
   // set permission for inline actions
   permission_level permissionLevel = permission_level(get_self(), name("active"));
-  action transferAction; 
-  // prepare arguments for stake sync
-  VoterArg sync;
-  sync.voter = voter; // set arguments
-  transferAction = action(
+  // prepare the stake sync
+  action sync = action(
       permissionLevel,
-      name("decide"), // contract to be called
+      DECIDE, // contract to be called
       name("sync"), // action to be called
-      std::move(sync));
-  transferAction.send(); // call
-
+      VoterArg());
+  for (auto& voter : voters) {
+    setname(sync, VOTER_OFFSET, voter); // set arguments
+    sync.send(); // call
+  }
+  // rebalance once all stakes are synced
   RebalArg args;
-  args.voter = voter; // set arguments
   args.ballot = ballot;
-  transferAction = action(
+  args.worker = get_self();
+  action rebalance = action(
       permissionLevel,
-      name("decide"), // contract to be called
+      DECIDE, // contract to be called
       name("rebalance"), // action to be called
-      std::move(args));
-  transferAction.send(); // call
+      args);
+  for (auto& voter : voters) {
+    setname(rebalance, VOTER_OFFSET, voter); // set arguments
+    rebalance.send(); // call
+  }
+}
+
+/*
+ * needssync()  Checks if syncing and rebalancing a voter would change the ballot.
+ *              Only voters who voted on the ballot can change it. Their vote is only off if either
+ *              their treasury stake or their vote weight differ from their current WAX stake,
+ *              which is what decide::sync reads.
+ * 
+ * requirements: none, unregistered voters are skipped.
+ * 
+ * arguments:
+ *    name voter: account to be checked    name ballot:  ballot that is currently voted on
+ * 
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+bool oig::needssync(name voter, name ballot) {
+  // skip voters who did not vote on the ballot
+  decidevotes_table votes(DECIDE, voter.value);
+  auto vote = votes.find(ballot.value);
+  if (vote == votes.end()) return false;
+  // skip voters not registered in the (8,VOTE) treasury, decide would reject them
+  decidevoters_table dvoters(DECIDE, voter.value);
+  auto dvoter = dvoters.find(VOTE_SYM.code().raw());
+  if (dvoter == dvoters.end()) return false;
+  // fetch the current WAX stake
+  int64_t stake = 0;
+  userres_table resources(name("eosio"), voter.value);
+  auto res = resources.find(voter.value);
+  if (res != resources.end()) {
+    stake = res->net_weight.amount + res->cpu_weight.amount;
+  }
+  return dvoter->staked.amount != stake || vote->raw_votes.amount != stake;
 }
 
 /*
@@ -450,88 +1015,117 @@ void oig::syncvoter (name voter, name ballot){
  *                  It guides the election based on the arguments provided during inauguration. 
  *                  It needs to be called recurringly to progress through the election states.
  *                  This is achieved by including it in user called actions and by manually
- *                  calling of updtstate(). For example by a cron job.
+ *                  calling of updtstate(). For example by a cron job, or by keepers calling crank().
+ *                  State changes are applied to the passed election record only, so every action
+ *                  loads and writes the election record once. 
  * 
  *  states: 
- *    00  - contract clean: 
- *                The contract is prepared to start a new election process.
+ *    00  - election cleaned: 
+ *                The election record is erased by storeelect().
  *    01  - election created
  *                Election is created, once elect.nmn_open is reached the contrac progresses to state 2,
  *                allowing nominations.
  *    02  - nomination in progress
- *                Waiting for Nominations to close. Once the deadline is reached a vector containing accepted
- *                nominations is build and the ballot created and set up.
- *                This includes sending a 30 WAX fee to decide.
- *                Contract is moved into state 3 afterward.
+ *                Waiting for Nominations to close. Once the deadline is reached the candidates table, filled
+ *                while nominations are accepted, is paged in batches of config.nmn_batch per call. The first batch creates and sets up
+ *                the ballot with its candidates as options, this includes sending a 30 WAX fee to decide.
+ *                Following batches add their candidates to the ballot as options.
+ *                Contract is moved into state 3 once all candidates are added.
  *    03  - nomination closed
  *                Once elect.vote_open is reached, decide will be called to open the ballot with the given end date.
  *                and move the contract into state 4.
  *    04  - voting in progress
- *                Contract will wait for elect.vote_close. 
- *                Once passed state_refresh() will start synchronizing all registered voters and 
- *                rebalancing the current ballot. To not run into excution time limits, 
- *                only 100 voters are synchronized per batch. As we could not test this yet, 
- *                this number might need to be reduced further.
+ *                Contract will wait for elect.vote_close. If config.presync_batch is set, every call 
+ *                until then syncs a small rolling batch of voters, see presync().
+ *                Once passed state_refresh() will start synchronizing all voters of the voter pool, 
+ *                shard by shard, and 
+ *                rebalancing the ballot, see syncbatch(). Voters that did not vote or whose stake did not change 
+ *                are only scanned, see needssync(). To not run into excution time limits, 
+ *                only config.sync_batch voters are synchronized per batch. As we could not test this yet, 
+ *                the default of 100 might need to be reduced further using setconfig().
+ *                Shards can also be synchronized in parallel by calling syncshard().
  *                Once all users are synchronized the ballot is closed and the contract moved into state 5.
  *    05  - voting commenced
  *                Voting has come to an end, and a winner should have been determined.
- *                The contract remains in state 5 for data persistence until 
- *                endelection() is called manually.
+ *                The ballot is closed with broadcast, onbroadcast() catches decide's notification,
+ *                archives the results and moves the election into state 6.
+ *                Otherwise the contract remains in state 5 for data persistence until 
+ *                endelection() is called manually, which archives the results.
  *    06  - cleanup initiated
- *                During cleanup all nominations and nominee info are deleted.
- *                Voters are reset to not synced by moving them back to the elect.voter vector.
+ *                During cleanup all nominations, nominee info and profiles are deleted. 
+ *                To not run into execution time limits, only config.cleanup_batch rows are erased per call.
+ *                Once all rows are erased the election is moved into state 0 and its record erased.
+ *                Voters don't need to be reset, every election keeps its own sync progress.
  *  Requirements:
  *    To host a ballot get_self needs to hold 30 WAX.
- *    elect.ballot is used as primary key for the ballot and needs to be unique.
+ *    elect.ballot is used as primary key for the ballot and needs to be unique, 
+ *    inaugurate() takes the next key from globalstate.last_ballot.
  *    To open the voting the ballot needs to contain at least 2 option to vote on.
  * 
- *  TODO:
- *    Change nominee tracking to a pre-built vector.
- *    Publish results / archive ballots.
+ *  arguments:
+ *    election& elect: the election record loaded by the calling action
+ * 
+ *  returns: true if elect was changed and needs to be written back by the caller.
+ * 
+ *  Every state transition and every processed batch is logged by an inline call of logstate().
  * 
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
-uint8_t oig::state_refresh() {
-    election_singleton elections(get_self(), get_self().value);
-    auto elect = elections.get();
-
+bool oig::state_refresh(election& elect) {
     auto now = time_point_sec(current_time_point());
+    uint8_t old_state = elect.state;
+    uint32_t old_processed = processed;
+    bool dirty = false;
 
     permission_level permissionLevel = permission_level(get_self(), name("active"));
     action transferAction;
 
     switch (elect.state) {
         case (0): // no current election
-          return elect.state;
+          break;
 
         case (1): // Election created, nominations not opened
             if (now >= elect.nmn_open) {
                 elect.state = 2; // open nominations
-                elections.set(elect, get_self());
+                processed++;
+                dirty = true;
+                break;
             }
             break;
 
         case (2): // nominations open
             if (now >= elect.nmn_close) { // once deadline is passed proceed to next stage
-              vector<name> ballot_options; // create the vector containing the candidates as ballot options
-
-              // we have a possible attack vector here.
-              // spammers could flood the nominee pool,
-              // leading to this transaction not being executed timely.
-              // To prevent this limitations to nominations have been put into place.
-              // In the future this needs to be reworked to allow for batched execution in case of spam.
-              // Placing a nomination fee is recommended.
-              nominations_table nominations(get_self(), get_self().value);
-              for (auto nmnt = nominations.begin(); nmnt != nominations.end(); ++nmnt) {
-                if (nmnt->accepted) {
-                  ballot_options.push_back(nmnt->nominee);
-                }
-              }
               // It needs to be ensured that at least two candidates accepted the nomination.
               // It is not possible to host an election with just one candidate.
-              // A possible measure would be to just enlist the contract itself as dummy.
-              if (size(ballot_options) >= 2 ){
-                // pay the Ballot fee of currently 30 WAX
+              // This is known from the counters, without touching the nominations.
+              if (elect.accepted_nominations < 2) {
+                break; // not enough candidates, the next acceptance closes nominations
+              }
+
+              // The accepted candidates are collected at acceptance by nominate() and proclaim(),
+              // so no nominations need to be walked. Self nominations are accepted right away, 
+              // so anyone can add a candidate. Every candidate row is paid by its nominee and 
+              // only a batch of rows is read per call, so a large field only costs more calls.
+              // The first batch creates the ballot with its candidates as initial options,
+              // following batches add their candidates to the ballot using decide::addoption.
+              // elect.nmn_cursor keeps the last candidate added, so every call resumes 
+              // where the last one stopped. nominate() and proclaim() freeze the table once nmn_added is set.
+              // elect.nmn_added counts the candidates added so far, the ballot exists once it is set.
+              candidates_table candidates(get_self(), elect.ballot.value);
+              bool ballot_created = elect.nmn_added > 0;
+              uint16_t batch = getconfig().nmn_batch;
+              vector<name> ballot_options; // candidates of the current batch
+              auto cand = candidates.upper_bound(elect.nmn_cursor.value);
+              for (; cand != candidates.end() && ballot_options.size() < batch; ++cand) {
+                ballot_options.push_back(cand->nominee);
+              }
+              if (!ballot_options.empty()) elect.nmn_cursor = ballot_options.back();
+              processed += ballot_options.size();
+              elect.nmn_added += ballot_options.size();
+
+              if (!ballot_created) {
+                // pay the Ballot fee of BALLOT_FEE, currently 30 WAX
                 BallotFeeArguments blargs;
+                blargs.sender = get_self();
                 transferAction= action(
                     permissionLevel,
                     name("eosio.token"),
@@ -544,10 +1138,10 @@ uint8_t oig::state_refresh() {
                 NewBallotArguments args;
                   args.ballot = elect.ballot; // ballot p-key
                   args.publisher = get_self();
-                  args.options = ballot_options;        
+                  args.options = ballot_options;
                 transferAction= action(
                     permissionLevel,
-                    name("decide"),
+                    DECIDE,
                     name("newballot"),
                     std::move(args)
                 );
@@ -561,7 +1155,7 @@ uint8_t oig::state_refresh() {
                     details.content = elect.content;        //ballot content
                 transferAction = action(
                     permissionLevel,
-                    name("decide"),
+                    DECIDE,
                     name("editdetails"),
                     std::move(details)
                 );
@@ -572,15 +1166,34 @@ uint8_t oig::state_refresh() {
                     toggle.ballot = elect.ballot; // as we want to only count staked tokens
                 transferAction = action(          // we need to toggle votestake
                     permissionLevel,
-                    name("decide"),
+                    DECIDE,
                     name("togglebal"),
                     std::move(toggle)
                 );
                 transferAction.send();
-                
+              } else {
+                // stream the candidates into the existing ballot
+                OptionArguments opt;
+                opt.ballot = elect.ballot;
+                action addoption = action(
+                    permissionLevel,
+                    DECIDE,
+                    name("addoption"),
+                    opt);
+                for (auto& option : ballot_options) {
+                  setname(addoption, OPTION_OFFSET, option);
+                  addoption.send();
+                }
+              }
+
+              if (cand == candidates.end()) { // all candidates are added to the ballot
                 elect.state = 3; // close nominations
-                elections.set(elect, get_self()); // write changes to election state
+                elect.nmn_added = 0; // reset the setup
+                elect.nmn_cursor = name();
+                processed++;
               }
+              dirty = true;
+              break;
             }
             break;
 
@@ -592,45 +1205,48 @@ uint8_t oig::state_refresh() {
                     open.end_time = elect.vote_close;
                 transferAction = action(
                     permissionLevel,
-                    name("decide"),
+                    DECIDE,
                     name("openvoting"),
                     std::move(open)
                 );
                 transferAction.send();
 
                 elect.state = 4; // open voting
-                elections.set(elect, get_self()); // write changes to election state
+                processed++;
+                dirty = true;
+                break;
             }
             break;
 
         case (4): // voting open
+            if (now < elect.vote_close) {
+              dirty = presync(elect); // spread the sync over the voting period if enabled
+              break;
+            }
             if (now >= elect.vote_close) {
 
-              uint8_t i = 0;
-              name voter;
-
-              // synchronize and rebalance voters in batches of 100 to prevent
+              // synchronize and rebalance voters in batches to prevent
               // the transaction of exceeding time limits.
-              while (elect.voter.size() != 0 && i < 100) {
-                voter = elect.voter.back(); 
-                syncvoter(voter, elect.ballot); //sync and rebalance
-                elect.synced_voter.push_back(voter); // remember regged voters for future elections
-                elect.voter.pop_back(); // remove synced voter
-                i++;
+              // Work on the first shard with unsynced voters, syncshard() allows to sync shards in parallel.
+              uint64_t shard = 0;
+              while (shard < VOTER_SHARDS && !syncbatch(elect.ballot, shard)) {
+                shard++;
               }
-              if (elect.voter.empty()) { // only close voting once all votes are synced
+              if (shard == VOTER_SHARDS) { // only close voting once all votes of all shards are synced
                 CloseArguments close;
                 close.ballot = elect.ballot;
                 transferAction = action(
                     permissionLevel,
-                    name("decide"),
+                    DECIDE,
                     name("closevoting"),
                     std::move(close));
                 transferAction.send();
 
                 elect.state = 5; // close voting
+                processed++;
+                dirty = true;
+                break;
               }
-              elections.set(elect, get_self());
             }
             break;
 
@@ -639,229 +1255,486 @@ uint8_t oig::state_refresh() {
             break;
 
         case (6): // election ended / cancelled
-            cleanup();
+            dirty = cleanbatch(elect); // only the final batch changes the election record
             break;
+
         default:
-            printf("Your princess is in another castle.");
+            logmsg<LOG_WARN>("unknown election state ", elect.ballot, " ", elect.state);
     }
-    return elect.state;
+
+    // log every state transition and batch for monitoring
+    if (elect.state != old_state || processed != old_processed) {
+      logbatch(elect.ballot, old_state, elect.state, processed - old_processed);
+    }
+    return dirty;
+}
+
+/*
+ *  logbatch()  Sends the inline logstate() action for a state transition or processed batch.
+ * 
+ *  arguments:
+ *    name ballot: election ballot      uint8_t old_state, new_state: state before and after the batch
+ *    uint32_t rows: rows and state transitions processed
+ * 
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+void oig::logbatch(name ballot, uint8_t old_state, uint8_t new_state, uint32_t rows) {
+  LogArguments log;
+  log.ballot = ballot;
+  log.old_state = old_state;
+  log.new_state = new_state;
+  log.rows = rows;
+  log.time = time_point_sec(current_time_point());
+  action(
+      permission_level(get_self(), name("active")),
+      get_self(),
+      name("logstate"),
+      std::move(log)).send();
 }
 
 /*
- *  cleanup()  Clears nominations, nominee info and swaps votes back into the unsynced pool.
- *             As voter registration is always open it needs to be doublechecked if users registered since last sync.
+ *  cleanup()  Runs a single cleanup batch, see cleanbatch().
  * 
  *  authorisation: contract
  *  requirements: Election in cleanup state.
  *  
+ *  arguments:
+ *    name ballot: election to clean up
+ * 
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
-void oig::cleanup(){
+ACTION oig::cleanup(name ballot){
   require_auth( get_self() );
-  // clear nominee info table
-  nominees_table nominees(get_self(), get_self().value);
+  elections_table elections(get_self(), get_self().value);
+  auto elect = elections.get(ballot.value, "Election not found.");
+  check(elect.state == 6, "Election not in cleanup state.");
+  if (cleanbatch(elect)) {
+    storeelect(elections, elect);
+  }
+}
+
+/*
+ *  scanvoters()  Scans up to 'batch' voters of a voter pool shard behind 'cursor' and syncs and rebalances
+ *                those whose vote is off, see needssync(). The batch is dispatched at once by syncvoters().
+ *                Shared by the closing sync and the rolling pre-sync, which keep separate cursors.
+ *  
+ *  arguments:
+ *    name ballot: ballot that is currently voted on    uint64_t shard: voter pool shard
+ *    name& cursor: last scanned voter, moved to the last voter of this batch
+ *    uint16_t batch: maximum voters to scan    uint16_t& scanned: set to the voters scanned
+ * 
+ *  returns: true if the end of the shard was reached.
+ * 
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+bool oig::scanvoters(name ballot, uint64_t shard, name& cursor, uint16_t batch, uint16_t& scanned) {
+  voterpool_table pool(get_self(), shard);
+  auto vtr = pool.upper_bound(cursor.value); // resume behind the last scanned voter
+  scanned = 0;
+  vector<name> voters; // collect the batch to be dispatched at once
+  for (; vtr != pool.end() && scanned < batch; ++vtr, scanned++) {
+    if (needssync(vtr->voter, ballot)) {
+      voters.push_back(vtr->voter);
+    }
+    cursor = vtr->voter;
+  }
+  if (!voters.empty()) {
+    syncvoters(voters, ballot); //sync and rebalance
+  }
+  return vtr == pool.end();
+}
+
+/*
+ *  syncbatch()  Synchronizes and rebalances the next config.sync_batch voters of one voter pool shard.
+ *               Every election walks the shard in primary key order, remembering its position in the
+ *               syncstates table scoped by the ballot. Overlapping elections don't share any sync state.
+ *               Voters drained into the pool after voting ended can't have voted, skipping them is safe.
+ *               Only touches the rows of the given shard, so multiple shards can be synced within one block.
+ *  
+ *  arguments:
+ *    name ballot: ballot that is currently voted on    uint64_t shard: voter pool shard
+ * 
+ *  returns: false if the shard was already fully synced.
+ * 
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+bool oig::syncbatch(name ballot, uint64_t shard) {
+  syncstates_table syncstates(get_self(), ballot.value);
+  auto sync = syncstates.find(shard);
+  if (sync == syncstates.end()) { // first batch of this ballot
+    sync = syncstates.emplace(get_self(), [&](auto& col) {
+      col.shard = shard;
+    });
+  }
+  if (sync->done) return false; // shard synced
+
+  uint16_t batch = getconfig().sync_batch;
+  uint16_t i = 0;
+  name cursor = sync->cursor;
+  bool done = scanvoters(ballot, shard, cursor, batch, i);
+  // track the sync progress of the shard
+  syncstates.modify(sync, same_payer, [&](auto& col) {
+    col.cursor = cursor;
+    col.synced += i;
+    col.done = done;
+  });
+  processed += i;
+  if (done) processed++; // count finishing the shard, it might not have scanned any voters
+  return true;
+}
+
+/*
+ *  presync()  Rolling stake sync while voting is open, spreading the closing sync over the voting period.
+ *             Every call scans the next config.presync_batch voters of one shard and syncs those whose
+ *             vote is off, see needssync(). Once the end of the shard is reached, the next shard follows.
+ *             The closing sync still scans every voter, but only voters that voted or changed their stake
+ *             since their pre-sync need inline actions, keeping the closing tail short.
+ *             Pre-synced rows are not counted as processed. A pre-sync batch is no progress of the 
+ *             election, so crank() runs a single one per call and doesn't reward it.
+ *  
+ *  arguments:
+ *    election& elect: the election record, changes need to be written back by the caller
+ * 
+ *  returns: true if elect was changed and needs to be written back by the caller.
+ * 
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+bool oig::presync(election& elect) {
+  uint16_t batch = getconfig().presync_batch;
+  if (batch == 0) return false; // pre-sync disabled
+
+  uint64_t shard = elect.presync_shard;
+  syncstates_table syncstates(get_self(), elect.ballot.value);
+  auto sync = syncstates.find(shard);
+  if (sync == syncstates.end()) {
+    sync = syncstates.emplace(get_self(), [&](auto& col) {
+      col.shard = shard;
+    });
+  }
+  uint16_t i = 0;
+  name cursor = sync->presync_cursor;
+  bool wrapped = scanvoters(elect.ballot, shard, cursor, batch, i);
+  syncstates.modify(sync, same_payer, [&](auto& col) {
+    col.presync_cursor = wrapped ? name() : cursor; // start over at the end of the shard
+  });
+  if (!wrapped) return false;
+  elect.presync_shard = (shard + 1) % VOTER_SHARDS; // continue with the next shard
+  return true;
+}
+
+/*
+ *  cleanbatch()  Clears profiles, nominee info, nominations and candidates.
+ *                All tables share a budget of config.cleanup_batch erased rows per call, as profiles can hold 
+ *                up to 2000 chars per row. Erasing always starts at the beginning of a table,
+ *                so an interrupted cleanup simply resumes with the next call.
+ *                The voter pool is left untouched, only the sync progress of the ballot is erased.
+ * 
+ *  requirements: Election in cleanup state.
+ *  
+ *  arguments:
+ *    election& elect: the election record, changes need to be written back by the caller
+ * 
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+bool oig::cleanbatch(election& elect){
+  uint16_t batch = getconfig().cleanup_batch;
+  uint16_t i = 0;
+  // clear profiles table
+  profiles_table profiles(get_self(), elect.ballot.value);
+  auto prfl = profiles.begin();
+  while (prfl != profiles.end() && i < batch) {
+      prfl = profiles.erase(prfl);
+      i++;
+  }
+  // clear nominee info table with the remaining budget
+  nominees_table nominees(get_self(), elect.ballot.value);
   auto nmne = nominees.begin();
-  while (nmne != nominees.end()) {
+  while (nmne != nominees.end() && i < batch) {
       nmne = nominees.erase(nmne);
+      i++;
   }
-  // clear nominations table
-  nominations_table nominations(get_self(), get_self().value);
+  // clear nominations table with the remaining budget
+  nominations_table nominations(get_self(), elect.ballot.value);
   auto nomn = nominations.begin();
-  while (nomn != nominations.end()) {
+  while (nomn != nominations.end() && i < batch) {
       nomn = nominations.erase(nomn);
+      i++;
+  }
+  // clear candidates table with the remaining budget
+  candidates_table candidates(get_self(), elect.ballot.value);
+  auto cand = candidates.begin();
+  while (cand != candidates.end() && i < batch) {
+      cand = candidates.erase(cand);
+      i++;
+  }
+  // clear the voter sync progress with the remaining budget
+  syncstates_table syncstates(get_self(), elect.ballot.value);
+  auto sync = syncstates.begin();
+  while (sync != syncstates.end() && i < batch) {
+      sync = syncstates.erase(sync);
+      i++;
+  }
+  processed += i;
+  if (prfl != profiles.end() || nmne != nominees.end() || nomn != nominations.end() || cand != candidates.end() || sync != syncstates.end()) {
+    return false; // rows left, continue on next call
   }
 
-  // reset the nominations counter
-  election_singleton elections(get_self(), get_self().value);
-  auto elect = elections.get();
-  elect.nom_count = 0;
-  
-  uint8_t i = 0;
-  name voter;
-  
-  if(!elect.synced_voter.empty()) { // if voters got synced in the prior election they need to be moved
-    if (!elect.voter.empty()) { // to not override entries we need to check if we have remaining entries
-      while (!elect.voter.empty() && i < 200) { // this is executed in batches to prevent time exceeds
-        voter = elect.voter.back();
-        elect.synced_voter.push_back(voter); // and if so move them to the synced pool for preservation
-        elect.voter.pop_back();
-        i++;
-      }
-    } else {
-      elect.voter = elect.synced_voter; // write all voters back to the pool.
-      elect.synced_voter.clear();
-      elect.state = 0;  // resetting the election state
+  // reset the nominations counters
+  elect.total_nominations = 0;
+  elect.accepted_nominations = 0;
+  elect.nmn_added = 0; // reset a possibly interrupted ballot setup
+  elect.nmn_cursor = name();
+  elect.state = 0;  // the election record gets erased by storeelect()
+  processed++;
+  return true;
+}
+
+/*
+ *  archive()  Reads the final tally of a concluded election from decide and appends it to the results table.
+ *             Called by onbroadcast() while decide closes the ballot, or by endelection() for ballots closed
+ *             without broadcast. closevoting runs after the rebalances of the voter sync, so in both cases
+ *             the tally includes all of them. Historic elections can be queried from the
+ *             results table, while cleanup only erases the working data.
+ *  
+ *  arguments:
+ *    const election& elect: the concluded election
+ * 
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+void oig::archive(const election& elect){
+  decideballots_table ballots(DECIDE, DECIDE.value);
+  auto& blt = ballots.get(elect.ballot.value, "Ballot not found.");
+
+  results_table results(get_self(), get_self().value);
+  check(results.find(elect.ballot.value) == results.end(), "Results already archived.");
+  results.emplace(get_self(), [&](auto& col) {
+    col.ballot = elect.ballot;
+    for (auto& opt : blt.options) {
+      col.tally.push_back(optiontally{opt.first, opt.second});
+    }
+    std::sort(col.tally.begin(), col.tally.end(), [](const optiontally& a, const optiontally& b) {
+      return a.votes.amount > b.votes.amount;
+    });
+    for (auto& entry : col.tally) { // all options tied with the most votes
+      if (entry.votes.amount != col.tally.front().votes.amount) break;
+      col.winners.push_back(entry.option);
     }
+    col.voters = blt.total_voters;
+    col.total_votes = blt.total_raw_weight;
+    col.closed = elect.vote_close;
+  });
+}
+
+/*
+ *  setcandidate()  Maintains the candidates of a ballot when nominations are accepted or declined.
+ *                  This moves the cost of collecting the candidates from closing nominations 
+ *                  to the acceptances, state_refresh() only pages the finished table.
+ *                  Each candidate row is paid by the nominee, who authorized the acceptance.
+ *  
+ *  arguments:
+ *    name ballot: election of the nomination    name nominee: accepted or declined nominee
+ *    bool accepted: add or remove the nominee
+ * 
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+void oig::setcandidate(name ballot, name nominee, bool accepted){
+  candidates_table candidates(get_self(), ballot.value);
+  if (accepted) {
+    candidates.emplace(nominee, [&](auto& col) {
+      col.nominee = nominee;
+    });
+  } else {
+    auto& cand = candidates.get(nominee.value, "Candidate not found.");
+    candidates.erase(cand);
+  }
+}
+
+/*
+ *  getconfig()  Returns the batch sizes and crank reward set by setconfig().
+ *               The config row is read on first use and cached for the rest of the action, so
+ *               helpers called once per batch, like syncbatch() in crank() rounds, don't re-read it.
+ * 
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+const oig::config& oig::getconfig() {
+  if (!config_loaded) {
+    config_singleton configs(get_self(), get_self().value);
+    config_cache = configs.get_or_default();
+    config_loaded = true;
+  }
+  return config_cache;
+}
+
+/*
+ *  storeelect()  Writes the election record back once per action.
+ *                Cleaned up elections (elect.state == 0) are erased.
+ *  
+ *  arguments:
+ *    elections_table& elections: the table the record got loaded from
+ *    const election& elect: the election record to be written
+ * 
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+void oig::storeelect(elections_table& elections, const election& elect){
+  auto itr = elections.require_find(elect.ballot.value, "Election not found.");
+  if (elect.state == 0) { // cleaned up
+    elections.erase(itr);
+    return;
   }
-  elections.set(elect, get_self());
+  elections.modify(itr, same_payer, [&](auto& col) {
+    col = elect;
+  });
 }
 
 
 
 //========== testing functions ==========
+#if OIG_TESTNET
 
 ACTION oig::setballot(name id) {
   require_auth( get_self() );
-  election_singleton elections(get_self(), get_self().value);
-  auto elect = elections.get();
-  elect.ballot = id;
-  elections.set(elect, get_self());
+  globalstate_singleton globals(get_self(), get_self().value);
+  auto global = globals.get_or_default();
+  global.last_ballot = id; // the next election is created as id + 1
+  globals.set(global, get_self());
 }
 
 /*
- * function() 
- * 
- * authorisation: 
- * requirements:
+ * fakenom() adds 'count' generated nominations to load test closing nominations and cleanup.
+ *           Use accepted to either simulate spam or a large candidate field.
  * 
- * arguments:
- * 
- * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
-ACTION oig::fakenom() {
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+ACTION oig::fakenom(name ballot, uint16_t count, bool accepted) {
   require_auth( get_self() );
 
   uint64_t tmp = name("fake").value;
   name nominee;
 
-  nominations_table nominations(get_self(), get_self().value);
-  uint8_t i;
+  nominations_table nominations(get_self(), ballot.value);
+  candidates_table candidates(get_self(), ballot.value);
+  uint16_t i = 0;
 
-  for (i = 0; i < 250; i++) {
-    nominee = name(tmp);
+  while (i < count) {
+    nominee = name(tmp++);
+    if (nominations.find(nominee.value) != nominations.end()) continue; // keep prior fake nominations
     nominations.emplace(get_self(), [&](auto& col) {
       col.nominee = nominee;
-      col.accepted = 0;
+      col.accepted = accepted;
     });
-    tmp++;
+    if (accepted) {
+      candidates.emplace(get_self(), [&](auto& col) {
+        col.nominee = nominee;
+      });
+    }
+    i++;
+  }
+  elections_table elections(get_self(), get_self().value);
+  auto elect = elections.get(ballot.value, "Election not found.");
+  elect.total_nominations += i;
+  if (accepted) {
+    elect.accepted_nominations += i;
   }
-  election_singleton elections(get_self(), get_self().value);
-  auto elect = elections.get();
-  elect.nom_count += i;
-  elections.set(elect, get_self());
+  storeelect(elections, elect);
 }
 
+/*
+ * fakevoters() adds 'count' generated voters to the voter pool to load test the voter sync.
+ *              Fake voters are not registered with decide, needssync() skips them after reading decide.
+ *              A sync over fake voters sends no sync or rebalance actions, it only measures the scan cost.
+ *              Call repeatedly to reach larger pools, each call continues after the last fake voter.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+ACTION oig::fakevoters(uint32_t count) {
+  require_auth( get_self() );
+
+  uint64_t tmp = name("fake.voter").value;
+  name voter;
+  uint32_t i = 0;
 
+  while (i < count) {
+    voter = name(tmp++);
+    if (!poolvoter(voter, get_self())) continue; // skip existing fake voters
+    i++;
+  }
+}
 
- *
+
+
+/*
  * simulate() proceeds an election to the next state by changing times.
- * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
-ACTION oig::simulate(){
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+ACTION oig::simulate(name ballot){
   require_auth( get_self() );
 
-  election_singleton elections(get_self(), get_self().value);
-  auto elect = elections.get();
+  elections_table elections(get_self(), get_self().value);
+  auto elect = elections.get(ballot.value, "Election not found.");
 
   auto now = time_point_sec(current_time_point());
 
   switch (elect.state) {
       case (1): // Election created, nominations not opened
           elect.nmn_open = now; // open nominations
-          elections.set(elect, get_self());
-          state_refresh();
           break;
 
       case (2): // nominations open
           elect.nmn_close = now;
-          elections.set(elect, get_self());
-          state_refresh();
           break;
 
       case (3): // nominations closed
           elect.vote_open = now;
           elect.vote_close = now + 900;
-          elections.set(elect, get_self());
-          state_refresh();
           break;
 
       case (4): // voting open
-          state_refresh();
-          break;
-
       case (5): // voting concluded
-          state_refresh();
           break;
 
       default:
-          printf("Your princess is in another castle.");
+          logmsg<LOG_WARN>("simulate: nothing to simulate in state ", elect.state);
   }
+  state_refresh(elect);
+  storeelect(elections, elect);
 }
 
- *
- * setvoters() allows to manually SET regged voters to be tracked.
- *             This will overwrite existing voters and should be used with caution.
- * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+/*
+ * setvoters() allows to manually add regged voters to the voter pool.
+ *             Voters are not registered with decide and should be used with caution.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 ACTION oig::setvoters(vector<name> voters) {
   require_auth( get_self() );
-  election_singleton elections(get_self(), get_self().value);
-  auto elect = elections.get();
-  elect.voter = voters;
-  elections.set(elect, get_self());
+  for (auto voter : voters) {
+    poolvoter(voter, get_self());
+  }
 }
 
- *
- * reset()  deletes the election singleton for table changes.
- *          Use with caution as a wrong init state or ballot key can deadlock the contract.
- * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
-ACTION oig::reset() {
+/*
+ * reset()  deletes an election record for table changes.
+ *          Use with caution, nominations and ballot of the election are left behind.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+ACTION oig::reset(name ballot) {
   require_auth( get_self() );
-  election_singleton elections(get_self(), get_self().value);
-  elections.remove();
+  elections_table elections(get_self(), get_self().value);
+  elections.erase(elections.get(ballot.value, "Election not found."));
 }
 
- *
+/*
  * addnomn()  allows to add a nominee to an existing ballot prior to the election beginning, 
  *            Only to be used to fix deadlocks during testing.
- * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
-ACTION oig::addnomn(name nominee){
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+ACTION oig::addnomn(name ballot, name nominee){
   require_auth( get_self() );
   permission_level permissionLevel = permission_level(get_self(), name("active"));
   action transferAction;
-  election_singleton elections(get_self(), get_self().value);
-  auto elect = elections.get();
-  struct Option {
-      name ballot;
-      name option;
-  };
-  Option opt;
-  opt.option = elect.ballot;
+  OptionArguments opt;
+  opt.ballot = ballot;
   opt.option = nominee;
   transferAction = action(
       permissionLevel,
-      name("decide"),
+      DECIDE,
       name("addoption"),
       std::move(opt)
   );
   transferAction.send();
 }
 
- *
+/*
  * addvoter() Adds an already registerd voter to the contracts tracking.
  *            Only needed for accounts used during first testing period.
  *            Do not use unless you are SURE the voter is registered on Decide for (8,VOTE)
- * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 ACTION oig::addvoter(name voter) {
   require_auth( get_self() );
   check(is_account(voter), "Voter account must exist.");
 
-  election_singleton elections(get_self(), get_self().value);
-  auto elect = elections.get();
-
-  reggedvoters_table reggedvoters(get_self(), voter.value);
-  auto voter_itr = reggedvoters.find(get_self().value);
-  if (voter_itr == reggedvoters.end()) {
-    reggedvoters.emplace(get_self(), [&](auto& col) {
-      col.referrer = get_self();
-      col.treasury = VOTE_SYM;
-      col.voter = voter;
-    });
-    if(!elect.synced_voter.empty()) {
-      if (!elect.voter.empty() ) {
-        elect.voter.push_back(voter);
-      } else {
-        elect.synced_voter.push_back(voter);
-      }
-    } else {
-      elect.voter.push_back(voter);
-    }
-    elections.set(elect, get_self());
-  }
-}*/
\ No newline at end of file
+  poolvoter(voter, get_self());
+}
+#endif